@@ -0,0 +1,161 @@
+#include <base/cpuTopology.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace hw {
+
+int CpuTopology::numLogicalCpus() const {
+  int n = 0;
+  for (const std::vector<int> &core : cores) {
+    n += static_cast<int>(core.size());
+  }
+  return n;
+}
+
+std::vector<int> CpuTopology::cpuOrder(bool skip_smt) const {
+  std::vector<int> order;
+  size_t max_siblings = 0;
+  for (const std::vector<int> &core : cores) {
+    max_siblings = std::max(max_siblings, core.size());
+  }
+  for (size_t sibling = 0; sibling < (skip_smt ? 1 : max_siblings);
+       sibling++) {
+    for (const std::vector<int> &core : cores) {
+      if (sibling < core.size()) {
+        order.push_back(core[sibling]);
+      }
+    }
+  }
+  return order;
+}
+
+#ifdef __linux__
+
+namespace {
+
+int readTopologyId(int cpu, const char *name) {
+  std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                     "/topology/" + name);
+  int id = -1;
+  if (!(file >> id)) {
+    return -1;
+  }
+  return id;
+}
+
+} // namespace
+
+CpuTopology detectCpuTopology() {
+  CpuTopology topology;
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    CPU_ZERO(&allowed);
+  }
+  // (package, core) -> index in cores, ordered by the first cpu of a core
+  std::map<std::pair<int, int>, size_t> core_index;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed)) {
+      continue;
+    }
+    const int package = readTopologyId(cpu, "physical_package_id");
+    const int core = readTopologyId(cpu, "core_id");
+    // without the ids the cpu is a core of its own
+    const std::pair<int, int> key =
+        core < 0 ? std::make_pair(-1 - cpu, 0) : std::make_pair(package, core);
+    const auto found = core_index.find(key);
+    if (found == core_index.end()) {
+      core_index[key] = topology.cores.size();
+      topology.cores.push_back({cpu});
+    } else {
+      topology.cores[found->second].push_back(cpu);
+    }
+  }
+  if (topology.cores.empty()) {
+    topology.cores.push_back({0});
+  }
+  return topology;
+}
+
+bool pinCurrentThread(int cpu) {
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+std::vector<int> currentThreadAffinity() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    return cpus;
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+bool setCurrentThreadAffinity(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if (CPU_COUNT(&set) == 0) {
+    return false;
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool unpinCurrentThread() {
+  // the id of the process is the one of its main thread
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(getpid(), sizeof(set), &set) != 0) {
+    return false;
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+#else
+
+CpuTopology detectCpuTopology() {
+  CpuTopology topology;
+  const int n = std::max(1u, std::thread::hardware_concurrency());
+  for (int cpu = 0; cpu < n; cpu++) {
+    topology.cores.push_back({cpu});
+  }
+  return topology;
+}
+
+bool pinCurrentThread(int) { return false; }
+
+std::vector<int> currentThreadAffinity() { return {}; }
+
+bool setCurrentThreadAffinity(const std::vector<int> &) { return false; }
+
+bool unpinCurrentThread() { return false; }
+
+#endif
+
+} // namespace hw
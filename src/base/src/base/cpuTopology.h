@@ -0,0 +1,46 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <vector>
+
+namespace hw {
+
+// The logical cpus this process may run on, grouped by physical core. SMT
+// siblings (hyper threads) share a core. Read from /sys/devices/system/cpu on
+// Linux, elsewhere every logical cpu counts as a core of its own.
+struct CpuTopology {
+  // cores[i]: the logical cpus of core i
+  std::vector<std::vector<int>> cores;
+
+  int numLogicalCpus() const;
+
+  // One logical cpu of every core first, the SMT siblings afterwards unless
+  // skip_smt. Pinning thread t to order[t] puts the first cores.size() threads
+  // on different cores.
+  std::vector<int> cpuOrder(bool skip_smt) const;
+};
+
+CpuTopology detectCpuTopology();
+
+// Restricts the calling thread to the logical cpu. Returns false if this is
+// not supported or not allowed.
+bool pinCurrentThread(int cpu);
+
+// The logical cpus the calling thread may run on, empty if this is not
+// supported.
+std::vector<int> currentThreadAffinity();
+
+// Restricts the calling thread to the logical cpus, e.g. to restore what
+// currentThreadAffinity() returned. Returns false if this is not supported or
+// not allowed.
+bool setCurrentThreadAffinity(const std::vector<int> &cpus);
+
+// Lets the calling thread run on every logical cpu of the process again, the
+// affinity of its main thread. Threads inherit the affinity of the thread
+// which started them, so a thread started by a pinned one is pinned as well.
+// Returns false if this is not supported or not allowed.
+bool unpinCurrentThread();
+
+} // namespace hw
+
+#endif
@@ -220,6 +220,24 @@ void PlanarTransformation::historyStepBack() {
   history.pop_back();
 }
 
+void PlanarTransformation::moveWorldOrigin(const Eigen::Vector2d &new_origin) {
+  // world_old = world_new + new_origin
+  Eigen::Matrix3d translation = Eigen::Matrix3d::Identity();
+  translation(0, 2) = new_origin.x();
+  translation(1, 2) = new_origin.y();
+
+  homographyWorld2Picture = homographyWorld2Picture * translation;
+  homographyPicture2World = homographyWorld2Picture.inverse();
+  setZerosInHomogen(homographyPicture2World);
+
+  for (auto &h : history) {
+    h = h * translation;
+  }
+  for (auto &h : recordedPerspective) {
+    h = h * translation;
+  }
+}
+
 void PlanarTransformation::setZerosInHomogen(Eigen::Matrix3d &h) const {
   h(0, 1) = 0;
   h(1, 0) = 0;
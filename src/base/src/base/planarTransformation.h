@@ -37,6 +37,11 @@ public:
 
   void historyStepBack();
 
+  // Shifts the world coordinate system such that the given world point becomes
+  // the new origin. The current view, the history and the recorded
+  // perspectives stay the same, only their coordinates change.
+  void moveWorldOrigin(const Eigen::Vector2d &new_origin);
+
   void initHomography(const Eigen::Vector2d &image_size,
                       const geometry::Rect &world_corners);
 
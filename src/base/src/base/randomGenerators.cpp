@@ -42,4 +42,10 @@ double randGaus(double mean, double variance) {
   return distribution(generator);
 }
 
+RandomStream::RandomStream(unsigned long seed, unsigned long stream) {
+  // seed_seq scrambles the pair, so neighbouring ids give unrelated states
+  std::seed_seq sequence{seed, stream};
+  generator.seed(sequence);
+}
+
 } // namespace func
@@ -32,6 +32,24 @@ double uniform_double_dist(double max, double min);
 //[variance]	Varianz der Normalverteilten Zufallsvariable
 double randGaus(double mean, double variance);
 
+// The functions above share one global generator, calling them from several
+// threads at once is a data race. Give every thread a RandomStream of its own
+// instead: streams with the same seed and different ids are independent of
+// each other and reproducible.
+class RandomStream {
+public:
+  RandomStream(unsigned long seed, unsigned long stream);
+
+  // uniformly distributed in [min, max)
+  double uniform(double min, double max) {
+    return min + distribution(generator) * (max - min);
+  }
+
+private:
+  std::mt19937_64 generator;
+  std::uniform_real_distribution<double> distribution{0., 1.};
+};
+
 
 }// namespace func
 
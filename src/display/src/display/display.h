@@ -3,17 +3,25 @@
 
 #include <base/color.hpp>
 #include <base/conversations.h>
+#include <base/cpuTopology.h>
 #include <base/functions.hpp>
 #include <base/macros.hpp>
 #include <base/planarTransformation.h>
 #include <base/randomGenerators.h>
 #include <base/structs.hpp>
+#include <mandelbrot/buddhabrot.h>
 #include <mandelbrot/mandelbrot.h>
+#include <mandelbrot/perturbation.h>
 #include <timer/timer.hpp>
 
-#include <boost/bind.hpp>
-#include <boost/function.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <eigen3/Eigen/Core>
+#include <functional>
+#include <limits>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -28,12 +36,51 @@ constexpr int DEFAULT_RESOLUTION_X = 600;
 constexpr int DEFAULT_RESOLUTION_Y = 600;
 #endif
 
-typedef boost::function<void(const int, const int)> DrawPixelWise;
-
+// Iteration limit of the first stage and number of survivors per package, see
+// Display::setStagedIterations().
+constexpr unsigned int STAGE_ITERATIONS = 256;
+constexpr int STAGE_PACKET_SIZE = 1024;
+
+// Size, iteration limit and time budget of the Julia preview, see
+// Display::setJuliaPreview().
+constexpr int JULIA_PREVIEW_SIZE_X = 240;
+constexpr int JULIA_PREVIEW_SIZE_Y = 160;
+constexpr unsigned int JULIA_PREVIEW_ITERATIONS = 256;
+constexpr double JULIA_PREVIEW_BUDGET_MS = 20.;
+
+// Number of rounds of the BUDDHABROT rendering, each one samples as many c as
+// the image has pixel. A thread samples BUDDHABROT_BATCH c between two checks
+// for a cancelled frame or the end of a time slice of the update loop.
+constexpr int BUDDHABROT_ROUNDS = 100;
+constexpr unsigned long BUDDHABROT_SEED = 1;
+constexpr long BUDDHABROT_BATCH = 4096;
+constexpr double BUDDHABROT_SLICE_MS = 50.;
+
+// Pixel which differ by more iterations from a neighbour get subsamples, see
+// Display::setAntiAliasing().
+constexpr double ANTI_ALIASING_EDGE_DIFFERENCE = 2.;
+constexpr int ANTI_ALIASING_PACKET_SIZE = 256;
+
+// Grid step of the first progressive preview, the next ones halve it. Only
+// frames following one slower than PROGRESSIVE_MIN_FRAME_MS get previews, see
+// Display::setProgressive().
+constexpr int PROGRESSIVE_COARSE_STEP = 4;
+constexpr double PROGRESSIVE_MIN_FRAME_MS = 50.;
+
+// How often the user input is polled while an interactive frame is
+// calculated, see Display::frameCancelled().
+constexpr double EVENT_POLL_MS = 30.;
+
+// Edge length of the tiles of the multithreaded pixel wise rendering, see
+// Display::setTileSize(). 64 x 64 results are 32 KB, they stay in L1/L2 while
+// a tile is calculated.
+constexpr int DEFAULT_TILE_SIZE = 64;
+
+// Hands out packets of consecutive indices. reset() must not be called while
+// threads take packets.
 struct MultithreadManager {
-  std::mutex access_thread_manager;
   int packet_size;
-  int current_managed_index;
+  std::atomic<int> current_managed_index{0};
   int max_index;
 
   void reset(int package_size_, int max_index_) {
@@ -43,26 +90,380 @@ struct MultithreadManager {
   }
 
   bool getNextPackage(int &from, int &to) {
-    access_thread_manager.lock();
-    bool work_not_done = true;
-    from = current_managed_index;
-    to = from + packet_size;
-    if (to > max_index) {
-      to = max_index;
-      if (from >= max_index) {
-        work_not_done = false;
+    from = current_managed_index.fetch_add(packet_size);
+    if (from >= max_index) {
+      return false;
+    }
+    to = std::min(from + packet_size, max_index);
+    return true;
+  }
+};
+
+// Pixel rectangle including its border: [x0, x1] x [y0, y1].
+struct PixelRect {
+  int x0, y0, x1, y1;
+};
+
+// Stack of rectangles for the Mariani-Silver subdivision. Workers pop a
+// rectangle, may push its subrectangles and call done() afterwards. pop()
+// returns false once the stack is empty and no worker can push anymore.
+struct MarianiSilverQueue {
+  std::mutex access_queue;
+  std::condition_variable queue_changed;
+  std::vector<PixelRect> rects;
+  int busy_workers = 0;
+
+  void reset(const PixelRect &rect) {
+    rects.clear();
+    rects.push_back(rect);
+    busy_workers = 0;
+  }
+
+  void push(const PixelRect &rect) {
+    {
+      std::lock_guard<std::mutex> lock(access_queue);
+      rects.push_back(rect);
+    }
+    queue_changed.notify_one();
+  }
+
+  bool pop(PixelRect &rect) {
+    std::unique_lock<std::mutex> lock(access_queue);
+    queue_changed.wait(lock,
+                       [this] { return !rects.empty() || busy_workers == 0; });
+    if (rects.empty()) {
+      return false;
+    }
+    rect = rects.back();
+    rects.pop_back();
+    busy_workers++;
+    return true;
+  }
+
+  void done() {
+    bool finished;
+    {
+      std::lock_guard<std::mutex> lock(access_queue);
+      busy_workers--;
+      finished = busy_workers == 0 && rects.empty();
+    }
+    if (finished) {
+      queue_changed.notify_all();
+    }
+  }
+};
+
+// Square tiles of the image for the multithreaded pixel wise rendering. Every
+// worker owns a range of consecutive tiles, i.e. a band of the image, and takes
+// them from the front. A worker whose range is empty steals the back half of
+// the largest remaining range. A range is only locked by its owner and by
+// thieves, so the locks are hardly ever contended.
+struct TileScheduler {
+  struct Worker {
+    std::mutex access;
+    int begin = 0;
+    int end = 0;
+    int steals = 0;
+    double busy_seconds = 0.;
+  };
+
+  std::vector<Worker> workers;
+  int size_x = 0;
+  int size_y = 0;
+  int tile_size = DEFAULT_TILE_SIZE;
+  int tiles_x = 0;
+  int num_tiles = 0;
+  std::chrono::steady_clock::time_point start;
+  // duration of the pass, see finish()
+  double seconds = 0.;
+
+  void reset(int size_x_, int size_y_, int tile_size_, int num_workers) {
+    size_x = size_x_;
+    size_y = size_y_;
+    tile_size = tile_size_;
+    tiles_x = (size_x + tile_size - 1) / tile_size;
+    num_tiles = tiles_x * ((size_y + tile_size - 1) / tile_size);
+    if (static_cast<int>(workers.size()) != num_workers) {
+      workers = std::vector<Worker>(num_workers);
+    }
+    for (int w = 0; w < num_workers; w++) {
+      workers[w].begin = static_cast<long>(num_tiles) * w / num_workers;
+      workers[w].end = static_cast<long>(num_tiles) * (w + 1) / num_workers;
+      workers[w].steals = 0;
+      workers[w].busy_seconds = 0.;
+    }
+    start = std::chrono::steady_clock::now();
+  }
+
+  // Sets rect to the next tile of worker, returns false if all tiles are
+  // taken.
+  bool getNextTile(int worker, PixelRect &rect) {
+    Worker &own = workers[worker];
+    int tile = -1;
+    {
+      std::lock_guard<std::mutex> lock(own.access);
+      if (own.begin < own.end) {
+        tile = own.begin++;
       }
     }
-    current_managed_index = to;
-    access_thread_manager.unlock();
-    return work_not_done;
+    while (tile < 0) {
+      Worker *victim = nullptr;
+      int most = 0;
+      for (Worker &other : workers) {
+        std::lock_guard<std::mutex> lock(other.access);
+        if (other.end - other.begin > most) {
+          most = other.end - other.begin;
+          victim = &other;
+        }
+      }
+      if (victim == nullptr) {
+        return false;
+      }
+      int from, to;
+      {
+        std::lock_guard<std::mutex> lock(victim->access);
+        to = victim->end;
+        from = to - (to - victim->begin + 1) / 2;
+        if (from >= to) {
+          // emptied by its owner or another thief meanwhile
+          continue;
+        }
+        victim->end = from;
+      }
+      std::lock_guard<std::mutex> lock(own.access);
+      tile = from;
+      own.begin = from + 1;
+      own.end = to;
+      own.steals++;
+    }
+    rect = tileRect(tile);
+    return true;
+  }
+
+  PixelRect tileRect(int tile) const {
+    PixelRect rect;
+    rect.x0 = (tile % tiles_x) * tile_size;
+    rect.y0 = (tile / tiles_x) * tile_size;
+    rect.x1 = std::min(rect.x0 + tile_size, size_x) - 1;
+    rect.y1 = std::min(rect.y0 + tile_size, size_y) - 1;
+    return rect;
+  }
+
+  // To be called after the pass, the rest of the pass is the idle time of a
+  // worker.
+  void finish() {
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
   }
 };
 
+// Workers which live as long as the Display, so the passes of a frame do not
+// create and join threads of their own. run(n, task) calls task(0) ... task(n
+// - 1) in parallel and returns when all are done. The caller does task(0),
+// task(t) always runs on the same worker, so data a task touched first stays
+// close to the core of its thread. Only one thread may call run() at a time.
+class ThreadPool {
+public:
+  ~ThreadPool() { stopWorkers(); }
+
+  // Without persistent workers run() starts and joins threads like before,
+  // to compare the dispatch overhead. The persistent workers are stopped
+  // then, they must not take part in a pass.
+  void setPersistent(bool persistent_) {
+    if (!persistent_) {
+      stopWorkers();
+    }
+    persistent = persistent_;
+  }
+
+  // Pins the worker of task t to the logical cpu cpus[t], see
+  // hw::pinCurrentThread(). The thread calling run() does task 0 on cpus[0]
+  // and gets its own affinity back when run() returns, so the threads it
+  // starts later are not pinned. Restarts the workers.
+  void setAffinity(const std::vector<int> &cpus_) {
+    stopWorkers();
+    cpus = cpus_;
+  }
+
+  void run(int num_tasks_, const std::function<void(int)> &task_) {
+    if (num_tasks_ <= 1) {
+      if (num_tasks_ == 1) {
+        task_(0);
+      }
+      return;
+    }
+    std::vector<int> caller_cpus;
+    if (!cpus.empty()) {
+      caller_cpus = hw::currentThreadAffinity();
+      pin(0);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(access);
+      task = &task_;
+      num_tasks = num_tasks_;
+      pending = num_tasks_;
+      longest_task = 0.;
+      generation++;
+    }
+    std::vector<std::thread> temporary;
+    if (persistent) {
+      while (static_cast<int>(workers.size()) < num_tasks_ - 1) {
+        workers.push_back(std::thread(
+            &ThreadPool::work, this, static_cast<int>(workers.size()) + 1));
+      }
+      wakeup.notify_all();
+    } else {
+      for (int t = 1; t < num_tasks_; t++) {
+        temporary.push_back(std::thread([this, t] {
+          pin(t);
+          runTask(t);
+        }));
+      }
+    }
+    runTask(0);
+    if (!caller_cpus.empty()) {
+      hw::setCurrentThreadAffinity(caller_cpus);
+    }
+    {
+      std::unique_lock<std::mutex> lock(access);
+      finished.wait(lock, [this] { return pending == 0; });
+      task = nullptr;
+    }
+    std::for_each(temporary.begin(), temporary.end(),
+                  std::mem_fn(&std::thread::join));
+    // Waking or starting the threads and waiting for them to finish, i.e.
+    // everything which made the pass take longer than its longest task.
+    dispatch_seconds +=
+        std::max(0.,
+                 std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                         .count() -
+                     longest_task);
+    dispatches++;
+  }
+
+  void resetStatistics() {
+    dispatches = 0;
+    dispatch_seconds = 0.;
+  }
+
+  long getDispatches() const { return dispatches; }
+
+  double getDispatchSeconds() const { return dispatch_seconds; }
+
+private:
+  void stopWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(access);
+      stop = true;
+    }
+    wakeup.notify_all();
+    std::for_each(workers.begin(), workers.end(),
+                  std::mem_fn(&std::thread::join));
+    workers.clear();
+    stop = false;
+  }
+
+  void pin(int t) const {
+    if (t < static_cast<int>(cpus.size())) {
+      hw::pinCurrentThread(cpus[t]);
+    }
+  }
+
+  void work(int t) {
+    pin(t);
+    unsigned long seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(access);
+        wakeup.wait(lock, [&] { return stop || generation != seen; });
+        if (stop) {
+          return;
+        }
+        seen = generation;
+        // a pass with fewer tasks than workers
+        if (t >= num_tasks) {
+          continue;
+        }
+      }
+      runTask(t);
+    }
+  }
+
+  void runTask(int t) {
+    const std::function<void(int)> *current;
+    {
+      std::lock_guard<std::mutex> lock(access);
+      current = task;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    (*current)(t);
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    std::lock_guard<std::mutex> lock(access);
+    longest_task = std::max(longest_task, seconds);
+    if (--pending == 0) {
+      finished.notify_one();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::vector<int> cpus;
+  std::mutex access;
+  std::condition_variable wakeup;
+  std::condition_variable finished;
+  const std::function<void(int)> *task = nullptr;
+  unsigned long generation = 0;
+  int num_tasks = 0;
+  int pending = 0;
+  bool stop = false;
+  bool persistent = true;
+  double longest_task = 0.;
+  long dispatches = 0;
+  double dispatch_seconds = 0.;
+};
+
 class Display {
 public:
   enum COLORING { COS, SPLINE };
 
+  // PIXEL_WISE: calculate every pixel.
+  // MARIANI_SILVER: calculate only the border of a rectangle and fill it if the
+  // border has the same value everywhere, otherwise subdivide it.
+  // BUDDHABROT: the density of the orbits of random escaping c. Every thread
+  // samples into its own histogram, they are merged after each round and the
+  // image is shown, so it converges while the user watches. The c are always
+  // sampled from [-2, 2] x [-2, 2], so this only works for views close to the
+  // start view: zoomed in, few orbits hit the view and it stays dark.
+  enum RENDERING { PIXEL_WISE, MARIANI_SILVER, BUDDHABROT };
+
+  // AUTOMATIC: choose one of the following depending on the pixel distance.
+  // FLOAT: every pixel is calculated in float with twice the SIMD lanes of
+  // double, good enough for the first few zoom levels.
+  // MIXED: every pixel is calculated in float, the ones close to the iteration
+  // limit or far off their neighbours are calculated again in double.
+  // DOUBLE: every pixel is calculated in double, breaks down around a pixel
+  // distance of 1e-13.
+  // DOUBLE_DOUBLE: every pixel is calculated in double-double, about 10 times
+  // slower than double but good for pixel distances down to 1e-26.
+  // FIXED_POINT: every pixel is calculated in 4.124 fixed point. Good down to
+  // 1e-34 and the iteration counts are the same on every machine, smoothing
+  // uses std::log2 of the C library though. Never chosen automatically.
+  // PERTURBATION: only the center is calculated in high precision, every pixel
+  // is calculated in double as difference to it, see Perturbation.
+  enum PRECISION {
+    AUTOMATIC,
+    FLOAT,
+    MIXED,
+    DOUBLE,
+    DOUBLE_DOUBLE,
+    FIXED_POINT,
+    PERTURBATION
+  };
+
   virtual bool isRunning() = 0;
 
   virtual void close() = 0;
@@ -78,23 +479,191 @@ public:
 
   virtual Eigen::Vector2d imageSize() const = 0;
 
-  void setDrawFunction(COLORING coloring) {
-    switch (coloring) {
-    case COLORING::COS: {
-      normalise_mandelbrot_iterations = true;
-      drawPixelWise_f = boost::bind(&Display::drawMandelbrotCOS, this, _1, _2);
-      break;
+  // Dispatches the pending mouse input to userMouseInteractionCallback() and
+  // the other callbacks. Called by the thread of the update loop while it
+  // calculates a frame, so a newer state can cancel it. Keys and actions that
+  // need a finished frame are left for drawNoUpdate() and the update loop.
+  virtual void pollEvents() {}
+
+  // Sets the pixel (0, y) to (n - 1, y) from n triples of 8 bit r, g, b. The
+  // colors of a frame are set row by row through this. Override it with a
+  // plain copy, the default calls setPixelColor() for every pixel.
+  virtual void setPixelRow(int y, const unsigned char *rgb, int n) {
+    for (int x = 0; x < n; x++) {
+      const color::RGB<int> rgbi(static_cast<int>(rgb[3 * x]),
+                                 static_cast<int>(rgb[3 * x + 1]),
+                                 static_cast<int>(rgb[3 * x + 2]));
+      setPixelColor(x, y, rgbi);
     }
-    case COLORING::SPLINE: {
-      normalise_mandelbrot_iterations = true;
-      drawPixelWise_f =
-          boost::bind(&Display::drawMandelbrotSPLINE, this, _1, _2);
-      break;
+  }
+
+  void setDrawFunction(COLORING coloring_) {
+    coloring = coloring_;
+    normalise_mandelbrot_iterations = true;
+  }
+
+  void setNumThreads(int num_threads_) { num_threads = num_threads_; }
+
+  // Edge length of the square tiles the threads calculate, see
+  // TileScheduler.
+  void setTileSize(int tile_size_) {
+    tile_size = std::max(1, tile_size_);
+    need_update = true;
+  }
+
+  // Configures the threads for this machine: one per physical core, or per
+  // logical cpu if not skip_smt, each pinned to its cpu. The calling thread
+  // and the update loop do the first task of a pass on the first cpu, only
+  // for the time of the pass. Picks the tile size with which the threads
+  // calculate the current view fastest and lets them write lastData first, so
+  // its pages are placed next to the cores which calculate them. The other
+  // buffers per pixel, like known_pixel and the state for resuming, are still
+  // written first by the update loop.
+  void autoConfigure(bool skip_smt = true) {
+    const hw::CpuTopology topology = hw::detectCpuTopology();
+    const std::vector<int> cpus = topology.cpuOrder(skip_smt);
+    setNumThreads(static_cast<int>(cpus.size()));
+    thread_pool.setAffinity(cpus);
+    std::cout << "threads: " << num_threads << " on "
+              << topology.cores.size() << " cores, "
+              << topology.numLogicalCpus() << " logical cpus" << std::endl;
+    calibrateTileSize();
+    touchFrameBuffer();
+  }
+
+  void setRendering(RENDERING rendering_) {
+    rendering = rendering_;
+    need_update = true;
+  }
+
+  void setPrecision(PRECISION precision_) {
+    precision = precision_;
+    need_update = true;
+  }
+
+  // The precision the last frame was calculated with.
+  PRECISION getFramePrecision() const { return frame_precision; }
+
+  // Fraction of the pixel of the last MIXED frame calculated again in double.
+  double getRecalculatedFraction() const { return recalculated_fraction; }
+
+  // The fractal to render, see formula::FORMULA. All but MANDELBROT are
+  // calculated in DOUBLE at most.
+  void setFormula(formula::FORMULA f) {
+    mandelbrot.setFormula(f);
+    need_update = true;
+  }
+
+  void setPeriodicityCheck(bool check) {
+    mandelbrot.setPeriodicityCheck(check);
+    need_update = true;
+  }
+
+  // Before calculating pixel, fill the tiles which interval arithmetic proves
+  // to be uniform. Only for FLOAT, MIXED and DOUBLE frames.
+  void setIntervalCulling(bool culling) {
+    interval_culling = culling;
+    need_update = true;
+  }
+
+  // Iterate frames with more than STAGE_ITERATIONS iterations in stages of
+  // growing iteration limits. Only the pixel which survived a stage are
+  // iterated further, densely packed so the threads and SIMD lanes share the
+  // few slow pixel evenly. Only for FLOAT and DOUBLE frames with PIXEL_WISE
+  // rendering.
+  void setStagedIterations(bool staged) {
+    staged_iterations = staged;
+    need_update = true;
+  }
+
+  // Calculate only one half of a view which contains both sides of the real
+  // axis and copy the mirrored rows. Only for PIXEL_WISE rendering.
+  void setSymmetry(bool symmetry_) {
+    symmetry = symmetry_;
+    need_update = true;
+  }
+
+  // Choose the iteration limit of every frame from a sparse sample grid of the
+  // view instead of the zoom. Usually fewer iterations in plain regions and
+  // more in detailed ones. Only for views with a pixel distance above 1e-13.
+  void setAdaptiveIterations(bool adaptive) {
+    adaptive_iterations = adaptive;
+    need_update = true;
+  }
+
+  // Time the sample grid of the last frame took, see setAdaptiveIterations().
+  double getAdaptiveSamplingTime() const { return adaptive_sampling_ms; }
+
+  // Keep the final Z of every pixel which did not escape. If only the
+  // iteration limit grows, e.g. by a MORE_DETAIL event, the next frame
+  // continues these pixel instead of starting all pixel again. Needs memory for
+  // the state of every pixel, so off by default. Only for FLOAT and DOUBLE
+  // frames with PIXEL_WISE rendering.
+  void setResumableIterations(bool resumable) {
+    resumable_iterations = resumable;
+    resume_iterations = 0;
+  }
+
+  // Show the Julia set of the point under the mouse next to the frame. A
+  // thread of its own renders it whenever the mouse moves, first coarse and
+  // then finer as long as JULIA_PREVIEW_BUDGET_MS allows. A preview is dropped
+  // as soon as the mouse moved on, so it never delays the frames.
+  void setJuliaPreview(bool preview) {
+    if (preview == julia_preview) {
+      return;
     }
+    julia_preview = preview;
+    if (preview) {
+      julia_stop = false;
+      julia_thread = std::thread(&Display::juliaPreviewLoop, this);
+      return;
     }
+    {
+      std::lock_guard<std::mutex> lock(julia_access);
+      julia_stop = true;
+      julia_pixel.clear();
+      julia_changed = true;
+    }
+    julia_wakeup.notify_one();
+    julia_thread.join();
   }
 
-  void setNumThreads(int num_threads_) { num_threads = num_threads_; }
+  // Average the colors of quality x quality jittered subsamples for the pixel
+  // which differ sharply from a neighbour, i.e. on the filaments and the
+  // borders. The other pixel are not touched, so this costs a fraction of
+  // supersampling the whole frame. Below 2 the anti-aliasing is off.
+  void setAntiAliasing(int quality) {
+    anti_aliasing = quality;
+    need_update = true;
+  }
+
+  // The passes of a frame run on workers which are kept between the frames.
+  // Turned off every pass starts and joins its own threads, see the
+  // dispatch overhead printed per frame.
+  void setPersistentThreads(bool persistent) {
+    persistent_threads = persistent;
+    thread_pool.setPersistent(persistent);
+  }
+
+  // Shows previews of slow frames while they are calculated: the pixel of
+  // every 4th row and column, then of every 2nd one, drawn as blocks. The
+  // finer passes and the frame itself skip the pixel calculated already.
+  void setProgressive(bool progressive_) { progressive = progressive_; }
+
+  bool getProgressive() const { return progressive; }
+
+  // Number of pixel which got subsamples in the last frame.
+  long getAntiAliasedPixel() const {
+    return static_cast<long>(anti_aliased_pixel.size());
+  }
+
+  // Number of pixel continued by the last frame, see setResumableIterations().
+  long getResumedPixel() const { return num_resumed_pixel; }
+
+  // Number of tiles of the last frame filled by the interval culling.
+  long getCulledTiles() const {
+    return culled_tiles_inside + culled_tiles_escaped;
+  }
 
   bool startUpdateLoop() {
     if (main_loop_running) {
@@ -136,7 +705,7 @@ protected:
     lastData.resize(DEFAULT_RESOLUTION_X, DEFAULT_RESOLUTION_Y);
   }
 
-  ~Display() {}
+  ~Display() { setJuliaPreview(false); }
 
   enum EVENT {
     LEFT_MOUSE_UP,
@@ -146,6 +715,12 @@ protected:
     PICTURE,
     RECORD,
     RENDER,
+    MORE_DETAIL,
+    JULIA_PREVIEW,
+    BUDDHABROT_MODE,
+    ANTI_ALIASING,
+    PERSISTENT_THREADS,
+    PROGRESSIVE,
     OTHER
   };
 
@@ -162,7 +737,7 @@ protected:
   Eigen::Vector2d getCurrentWorldPosition() const {
     Eigen::Vector2d world;
     planar_transformation.transformToWorld(imageSize() * 0.5, world);
-    return world;
+    return world + world_origin;
   }
 
   double getCurrentWorldZoom() const {
@@ -209,18 +784,51 @@ protected:
       draw_zoom_window = false;
     } else if (event == EVENT::MOUSE_MOVE) {
       current_mouse_picture_pos = mousePos;
+      if (julia_preview) {
+        requestJuliaPreview(mousePos);
+      }
     } else if (event == EVENT::RIGHT_MOUSE_CLICK) {
-      planar_transformation.historyStepBack();
-      need_update = true;
+      // like the zoom applied by the update loop, not in the middle of a frame
+      step_back = true;
     } else if (event == EVENT::PICTURE) {
-      saveCurrentImage();
+      // saved by the update loop once the frame is finished
+      save_picture = true;
     } else if (event == EVENT::RECORD) {
       planar_transformation.recordCurrentPerspective();
     } else if (event == EVENT::RENDER) {
       renderVideo();
+    } else if (event == EVENT::MORE_DETAIL) {
+      // twice the iterations for the current view
+      iteration_factor *= 2.;
+      need_update = true;
+    } else if (event == EVENT::JULIA_PREVIEW) {
+      setJuliaPreview(!julia_preview);
+    } else if (event == EVENT::ANTI_ALIASING) {
+      setAntiAliasing(anti_aliasing > 1 ? 0 : 3);
+    } else if (event == EVENT::PROGRESSIVE) {
+      setProgressive(!progressive);
+    } else if (event == EVENT::PERSISTENT_THREADS) {
+      setPersistentThreads(!persistent_threads);
+      need_update = true;
+    } else if (event == EVENT::BUDDHABROT_MODE) {
+      setRendering(rendering == RENDERING::BUDDHABROT ? RENDERING::PIXEL_WISE
+                                                      : RENDERING::BUDDHABROT);
     }
   }
 
+  // Copies the newest preview into pixel, JULIA_PREVIEW_SIZE_X pixel per row.
+  // Returns false if it did not change since the last call. pixel is empty if
+  // the preview was switched off.
+  bool takeJuliaPreview(std::vector<color::RGB<int>> &pixel) {
+    std::lock_guard<std::mutex> lock(julia_access);
+    if (!julia_changed) {
+      return false;
+    }
+    julia_changed = false;
+    pixel = julia_pixel;
+    return true;
+  }
+
   // virtual void callUserMouseInteractionCallback() = 0; TODO
 
   unsigned int getMandelbrotIterations() const {
@@ -238,35 +846,209 @@ protected:
   }
 
   void calculateImage(bool load_from_stored) {
+    // The periodicity check must not confuse points closer than a pixel.
+    const double pixel_distance = 1. / std::abs(getCurrentWorldZoom());
+    mandelbrot.setPeriodicityEpsilon(std::min(1e-12, pixel_distance * 1e-3));
     chooseNumCalculations();
     if (load_from_stored) {
       drawAllPixel();
       return;
     }
-    if (num_threads > 1) {
-      const int numPixel = getWindowSizeX() * getWindowSizeY();
-      // Dont make the size too small to avoid "too much access to the Thread
-      // manager which is mutexed. Dont make the size too big to avoid one
-      // thread to be finnished with nothing to do left while others are still
-      // calculateing.
-      const int package_size = getWindowSizeX();
-      multithreadManager.reset(package_size, numPixel);
-
-      std::vector<std::thread> threadpool;
-
-      for (int t = 0; t < num_threads; t++) {
-        // starting the thread
-        threadpool.push_back(
-            std::thread(&Display::calculateImageMultiThreaded, this));
+    const auto frame_start = std::chrono::steady_clock::now();
+    anti_aliased_pixel.clear();
+    thread_pool.resetStatistics();
+    tiled_frame = false;
+    progressive_passes = 0;
+    frame_cancelled = false;
+    if (rendering == RENDERING::BUDDHABROT) {
+      startBuddhabrot();
+      // the first round is not sliced, only a cancelled frame stops it
+      if (!refineBuddhabrot(std::numeric_limits<double>::max())) {
+        cancelFrame();
       }
-
-      // wait until all are finnished
-      std::for_each(threadpool.begin(), threadpool.end(),
-                    std::mem_fn(&std::thread::join));
-
+      return;
+    }
+    mandelbrot.resetStatistics();
+    frame_precision = choosePrecision();
+    // the deep zoom tiers only iterate z^2 + c
+    if (mandelbrot.getFormula() != formula::MANDELBROT &&
+        (frame_precision == PRECISION::DOUBLE_DOUBLE ||
+         frame_precision == PRECISION::FIXED_POINT ||
+         frame_precision == PRECISION::PERTURBATION)) {
+      frame_precision = PRECISION::DOUBLE;
+    }
+    if (frame_precision == PRECISION::PERTURBATION) {
+      calculatePerturbationReference();
+    }
+    findMirroredRows();
+    resume_active = resumable_iterations &&
+                    rendering == RENDERING::PIXEL_WISE &&
+                    (frame_precision == PRECISION::FLOAT ||
+                     frame_precision == PRECISION::DOUBLE);
+    resuming = resume_active && canResume();
+    num_resumed_pixel = 0;
+    if (resuming) {
+      prepareResume();
+    } else if (resume_active) {
+      const int num_pixel = getWindowSizeX() * getWindowSizeY();
+      // culled pixel are exact and keep this state, see calculateRun()
+      resume_zr.assign(num_pixel, 0.);
+      resume_zi.assign(num_pixel, 0.);
+      resume_saved_zr.assign(num_pixel, 0.);
+      resume_saved_zi.assign(num_pixel, 0.);
+      resume_unresolved.assign(num_pixel, 0);
+    }
+    // The tiles are bounded in double coordinates. A resumed frame has no
+    // unresolved pixel in them.
+    interval_culling_active =
+        interval_culling && !resuming &&
+        mandelbrot.getFormula() == formula::MANDELBROT &&
+        (frame_precision == PRECISION::FLOAT ||
+         frame_precision == PRECISION::MIXED ||
+         frame_precision == PRECISION::DOUBLE);
+    if (interval_culling_active) {
+      cullTiles();
+    }
+    known_pixel_active = interval_culling_active;
+    // The previews do not keep the state of their pixel for resuming.
+    if (progressive && rendering == RENDERING::PIXEL_WISE && !resume_active &&
+        last_frame_seconds * 1e3 > PROGRESSIVE_MIN_FRAME_MS) {
+      if (!known_pixel_active) {
+        known_pixel.assign(getWindowSizeX() * getWindowSizeY(), 0);
+        known_pixel_active = true;
+      }
+      for (int step = PROGRESSIVE_COARSE_STEP; step > 1; step /= 2) {
+        calculatePreview(step);
+        if (frameCancelled(0)) {
+          cancelFrame();
+          return;
+        }
+        drawPreview(step);
+        updateImage();
+        if (progressive_passes++ == 0) {
+          first_image_seconds = std::chrono::duration<double>(
+                                    std::chrono::steady_clock::now() -
+                                    frame_start)
+                                    .count();
+        }
+      }
+    }
+    staged_active = staged_iterations &&
+                    rendering == RENDERING::PIXEL_WISE &&
+                    (frame_precision == PRECISION::FLOAT ||
+                     frame_precision == PRECISION::DOUBLE) &&
+                    mandelbrot.getMaxIterations() > STAGE_ITERATIONS;
+    if (rendering == RENDERING::MARIANI_SILVER) {
+      calculateImageMarianiSilver();
+    } else if (staged_active) {
+      calculateImageStaged();
+    } else if (num_threads > 1) {
+      tile_scheduler.reset(
+          getWindowSizeX(), getWindowSizeY(), tile_size, num_threads);
+      thread_pool.run(num_threads,
+                      [this](int t) { calculateImageMultiThreaded(t); });
+      tile_scheduler.finish();
+      tiled_frame = true;
     } else {
       calculateImageSingleThreaded();
     }
+    if (frameCancelled(0)) {
+      cancelFrame();
+      return;
+    }
+    copyMirroredRows();
+
+    if (frame_precision == PRECISION::MIXED) {
+      recalculateImprecisePixel();
+    }
+    if (resume_active) {
+      storeResumeState();
+    }
+    if (anti_aliasing > 1) {
+      antiAlias();
+    }
+
+    last_frame_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      frame_start)
+            .count();
+
+    std::cout << "precision: " << precisionName(frame_precision) << std::endl;
+    if (cancelled_frames > 0) {
+      std::cout << "cancelled " << cancelled_frames
+                << " outdated frames before this one" << std::endl;
+      cancelled_frames = 0;
+    }
+    if (progressive_passes > 0) {
+      std::cout << "progressive: " << progressive_passes
+                << " previews, the first after " << first_image_seconds * 1e3
+                << " ms" << std::endl;
+    }
+    if (tiled_frame) {
+      int steals = 0;
+      for (const TileScheduler::Worker &worker : tile_scheduler.workers) {
+        steals += worker.steals;
+      }
+      std::cout << "tiles: " << tile_scheduler.num_tiles << " of "
+                << tile_scheduler.tile_size << " pixel, " << steals
+                << " steals, busy/idle ms per thread:";
+      for (const TileScheduler::Worker &worker : tile_scheduler.workers) {
+        std::cout << " " << worker.busy_seconds * 1e3 << "/"
+                  << (tile_scheduler.seconds - worker.busy_seconds) * 1e3;
+      }
+      std::cout << std::endl;
+    }
+    if (thread_pool.getDispatches() > 0) {
+      std::cout << "dispatch: " << thread_pool.getDispatches() << " passes, "
+                << thread_pool.getDispatchSeconds() * 1e6 << " us overhead ("
+                << (persistent_threads ? "persistent" : "new") << " threads)"
+                << std::endl;
+    }
+    if (anti_aliasing > 1) {
+      std::cout << "anti-aliasing: " << anti_aliased_pixel.size()
+                << " pixel with " << anti_aliasing * anti_aliasing
+                << " subsamples" << std::endl;
+    }
+    if (resuming) {
+      std::cout << "resumed " << num_resumed_pixel << " pixel at iteration "
+                << resume_from << std::endl;
+    }
+    if (staged_active) {
+      std::cout << "staged iterations: pixel per stage";
+      for (const long survivors : stage_survivors) {
+        std::cout << " " << survivors;
+      }
+      std::cout << std::endl;
+    }
+    if (num_mirrored_rows > 0) {
+      std::cout << "symmetry: copied " << num_mirrored_rows << " rows"
+                << std::endl;
+    }
+    if (interval_culling_active) {
+      std::cout << "interval culling: " << culled_tiles_inside
+                << " tiles inside, " << culled_tiles_escaped
+                << " tiles escaping of " << num_tiles << " tiles" << std::endl;
+    }
+    if (frame_precision == PRECISION::MIXED) {
+      std::cout << "mixed precision: recalculated "
+                << recalculated_fraction * 100. << "% of the pixel in double"
+                << std::endl;
+    }
+    if (frame_precision == PRECISION::PERTURBATION) {
+      std::cout << "perturbation: reference length "
+                << perturbation.getReferenceLength() << ", skipped "
+                << perturbation.getSkippedIterations() << " iterations, "
+                << perturbation.getRebases() << " rebases" << std::endl;
+    } else if (mandelbrot.getPeriodicityCheck()) {
+      std::cout << "periodicity check stopped "
+                << mandelbrot.getPeriodicityShortcuts() << " pixel"
+                << std::endl;
+    }
+    if (mandelbrot.getComponentLookup()) {
+      std::cout << "component lookup classified "
+                << mandelbrot.getComponentShortcuts() << " pixel as inside"
+                << std::endl;
+    }
 
     if (normalise_mandelbrot_iterations) {
       normalizeLastData();
@@ -282,83 +1064,1509 @@ private:
     const double max_log_zoom = 35;
     // depending on zoom factor wee need more iterations
     const double zoom = std::log(-getCurrentWorldZoom());
-    const unsigned int iterations =
-        static_cast<unsigned int>(zoom * iteration_resolution / max_log_zoom) +
-        62;
+    unsigned int iterations = static_cast<unsigned int>(
+        (zoom * iteration_resolution / max_log_zoom + 62) * iteration_factor);
+    // The samples are calculated in double.
+    constexpr double MIN_PIXEL_DISTANCE_SAMPLING = 1e-13;
+    adaptive_sampling_ms = 0.;
+    if (adaptive_iterations &&
+        1. / std::abs(getCurrentWorldZoom()) > MIN_PIXEL_DISTANCE_SAMPLING) {
+      const unsigned int formula_iterations = iterations;
+      const auto start = std::chrono::steady_clock::now();
+      iterations = static_cast<unsigned int>(sampleIterations() *
+                                             iteration_factor);
+      adaptive_sampling_ms = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+      std::cout << "adaptive iterations: " << iterations << " instead of "
+                << formula_iterations << ", sampling took "
+                << adaptive_sampling_ms << "ms" << std::endl;
+    }
     mandelbrot.setMaxIterations(iterations);
     std::cout << "zoom: " << zoom << "-"
               << "iterations: " << iterations << std::endl;
   };
 
+  // Iterates a sparse grid of the view with doubling limits and returns the
+  // smallest limit after which doubling lets less than ESCAPE_TOLERANCE of the
+  // samples escape. Deep views have no escapes at all for the first limits, so
+  // that only counts once some samples escaped. The samples keep their Z
+  // between the limits, so this costs about as much as calculating the
+  // samples once with the returned limit.
+  unsigned int sampleIterations() {
+    constexpr int SAMPLES_X = 96;
+    constexpr int SAMPLES_Y = 48;
+    constexpr unsigned int MIN_ITERATIONS = 64;
+    constexpr unsigned int MAX_ITERATIONS = 1 << 16;
+    constexpr double ESCAPE_TOLERANCE = 1e-3;
+    std::vector<double> re, im;
+    const Eigen::Vector2d size = imageSize();
+    for (int y = 0; y < SAMPLES_Y; y++) {
+      for (int x = 0; x < SAMPLES_X; x++) {
+        Eigen::Vector2d world;
+        planar_transformation.transformToWorld(
+            Eigen::Vector2d((x + 0.5) * size.x() / SAMPLES_X,
+                            (y + 0.5) * size.y() / SAMPLES_Y),
+            world);
+        re.push_back(world.x() + world_origin.x());
+        im.push_back(world.y() + world_origin.y());
+      }
+    }
+    const int num_samples = static_cast<int>(re.size());
+    std::vector<double> zr(num_samples, 0.), zi(num_samples, 0.);
+    std::vector<double> saved_zr(num_samples, 0.), saved_zi(num_samples, 0.);
+    std::vector<double> result(num_samples);
+    std::vector<unsigned char> unresolved(num_samples);
+
+    unsigned int start = 0;
+    unsigned int limit = MIN_ITERATIONS;
+    int total_escaped = 0;
+    while (true) {
+      const int n = static_cast<int>(re.size());
+      mandelbrot.setMaxIterations(limit);
+      mandelbrot.mandelbrot(re.data(),
+                            im.data(),
+                            n,
+                            start,
+                            zr.data(),
+                            zi.data(),
+                            saved_zr.data(),
+                            saved_zi.data(),
+                            unresolved.data(),
+                            result.data());
+      // Escaped samples are outside the escape radius, periodic ones and the
+      // ones inside M1 and M2 are not. Keep only the unresolved ones.
+      int escaped = 0;
+      int survivors = 0;
+      for (int k = 0; k < n; k++) {
+        if (!unresolved[k]) {
+          escaped += zr[k] * zr[k] + zi[k] * zi[k] > 4. ? 1 : 0;
+          continue;
+        }
+        re[survivors] = re[k];
+        im[survivors] = im[k];
+        zr[survivors] = zr[k];
+        zi[survivors] = zi[k];
+        saved_zr[survivors] = saved_zr[k];
+        saved_zi[survivors] = saved_zi[k];
+        survivors++;
+      }
+      re.resize(survivors);
+      im.resize(survivors);
+      zr.resize(survivors);
+      zi.resize(survivors);
+      saved_zr.resize(survivors);
+      saved_zi.resize(survivors);
+      // the first escapes have no limit to compare with
+      if (total_escaped > 0 && escaped < ESCAPE_TOLERANCE * num_samples) {
+        return start;
+      }
+      total_escaped += escaped;
+      if (survivors == 0 || limit == MAX_ITERATIONS) {
+        return limit;
+      }
+      start = limit;
+      limit *= 2;
+    }
+  }
+
+  void requestJuliaPreview(const Eigen::Vector2d &mousePos) {
+    Eigen::Vector2d c;
+    planar_transformation.transformToWorld(mousePos, c);
+    c += world_origin;
+    {
+      std::lock_guard<std::mutex> lock(julia_access);
+      julia_c = c;
+      julia_formula = mandelbrot.getFormula();
+      julia_generation++;
+    }
+    julia_wakeup.notify_one();
+  }
+
+  // Renders the requested previews in passes of every 4th, 2nd and finally
+  // every pixel. Each finished pass is published. A pass is abandoned as soon
+  // as a newer request arrives, the finer ones also when the time budget is
+  // used up.
+  void juliaPreviewLoop() {
+    hw::unpinCurrentThread();
+    // own instance, the settings of the frames may change meanwhile
+    Mandelbrot julia;
+    julia.setMaxIterations(JULIA_PREVIEW_ITERATIONS);
+    julia.setSmoothing(true);
+    constexpr double EXTENT_X = 4.2;
+    constexpr double EXTENT_Y =
+        EXTENT_X * JULIA_PREVIEW_SIZE_Y / JULIA_PREVIEW_SIZE_X;
+    constexpr double PIXEL_DISTANCE = EXTENT_X / JULIA_PREVIEW_SIZE_X;
+    std::vector<double> data(JULIA_PREVIEW_SIZE_X * JULIA_PREVIEW_SIZE_Y);
+    std::vector<double> re(JULIA_PREVIEW_SIZE_X), im(JULIA_PREVIEW_SIZE_X);
+    std::vector<double> result(JULIA_PREVIEW_SIZE_X);
+    std::vector<color::RGB<int>> pixel(data.size());
+    unsigned long rendered = 0;
+    while (true) {
+      Eigen::Vector2d c;
+      {
+        std::unique_lock<std::mutex> lock(julia_access);
+        julia_wakeup.wait(lock, [&] {
+          return julia_stop || julia_generation != rendered;
+        });
+        if (julia_stop) {
+          return;
+        }
+        rendered = julia_generation;
+        c = julia_c;
+        julia.setFormula(julia_formula);
+      }
+      const auto start = std::chrono::steady_clock::now();
+      for (int step = 4; step > 0; step /= 2) {
+        bool abandoned = false;
+        for (int y = 0; y < JULIA_PREVIEW_SIZE_Y; y += step) {
+          const double elapsed_ms =
+              std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+          if (julia_generation != rendered ||
+              (step < 4 && elapsed_ms > JULIA_PREVIEW_BUDGET_MS)) {
+            abandoned = true;
+            break;
+          }
+          // every 2nd pixel of every 2nd row is known from the coarser pass,
+          // its block already holds its value
+          const bool known_row = step < 4 && y % (2 * step) == 0;
+          const int x0 = known_row ? step : 0;
+          const int dx = known_row ? 2 * step : step;
+          int n = 0;
+          for (int x = x0; x < JULIA_PREVIEW_SIZE_X; x += dx) {
+            re[n] = -0.5 * EXTENT_X + x * PIXEL_DISTANCE;
+            im[n] = 0.5 * EXTENT_Y - y * PIXEL_DISTANCE;
+            n++;
+          }
+          julia.julia(c.x(), c.y(), re.data(), im.data(), n, result.data());
+          // the coarse passes fill the whole block of the pixel
+          for (int by = y; by < std::min(y + step, JULIA_PREVIEW_SIZE_Y);
+               by++) {
+            for (int i = 0; i < n; i++) {
+              const int x = x0 + i * dx;
+              for (int bx = x; bx < std::min(x + step, JULIA_PREVIEW_SIZE_X);
+                   bx++) {
+                data[by * JULIA_PREVIEW_SIZE_X + bx] = result[i];
+              }
+            }
+          }
+        }
+        if (abandoned) {
+          break;
+        }
+        // normalize like normalizeLastData()
+        const auto min_max = std::minmax_element(data.begin(), data.end());
+        const double min = *min_max.first;
+        const double span = *min_max.second - min;
+        const double multiply =
+            span > 0. ? JULIA_PREVIEW_ITERATIONS / span : 0.;
+        for (size_t i = 0; i < data.size(); i++) {
+          pixel[i] = julia.mandelbrotCOS((data[i] - min) * multiply);
+        }
+        std::lock_guard<std::mutex> lock(julia_access);
+        if (julia_stop || julia_generation != rendered) {
+          break;
+        }
+        julia_pixel = pixel;
+        julia_changed = true;
+      }
+    }
+  }
+
+  // The coloring is chosen once per frame, the loops of drawAllPixel<>() call
+  // no function pointer and no virtual function per pixel.
   void drawAllPixel() {
-    for (int col = 0; col < resolution_x; col++) {
-      for (int row = 0; row < resolution_y; row++) {
-        drawPixelWise_f(col, row);
+    switch (coloring) {
+    case COLORING::COS:
+      drawAllPixel<COLORING::COS>();
+      break;
+    case COLORING::SPLINE:
+      drawAllPixel<COLORING::SPLINE>();
+      break;
+    }
+  }
+
+  template <COLORING Coloring> void drawAllPixel() {
+    std::vector<unsigned char> rgb(3 * resolution_x);
+    const int samples = anti_aliasing * anti_aliasing;
+    // anti_aliased_pixel is sorted
+    size_t next = 0;
+    for (int row = 0; row < resolution_y; row++) {
+      for (int col = 0; col < resolution_x; col++) {
+        colorize<Coloring>(lastData(col, row), &rgb[3 * col]);
+      }
+      // the anti-aliased pixel average the colors of their subsamples
+      for (; next < anti_aliased_pixel.size() &&
+             anti_aliased_pixel[next] < (row + 1) * resolution_x;
+           next++) {
+        const int col = anti_aliased_pixel[next] % resolution_x;
+        int sum[3] = {rgb[3 * col], rgb[3 * col + 1], rgb[3 * col + 2]};
+        for (int s = 0; s < samples; s++) {
+          const double value = anti_aliasing_samples[next * samples + s];
+          unsigned char subsample[3];
+          colorize<Coloring>((value - normalize_min) * normalize_multiply,
+                             subsample);
+          for (int c = 0; c < 3; c++) {
+            sum[c] += subsample[c];
+          }
+        }
+        for (int c = 0; c < 3; c++) {
+          rgb[3 * col + c] = static_cast<unsigned char>(
+              (sum[c] + (samples + 1) / 2) / (samples + 1));
+        }
+      }
+      setPixelRow(row, rgb.data(), resolution_x);
+    }
+  }
+
+  void drawPreview(int step) {
+    switch (coloring) {
+    case COLORING::COS:
+      drawPreview<COLORING::COS>(step);
+      break;
+    case COLORING::SPLINE:
+      drawPreview<COLORING::SPLINE>(step);
+      break;
+    }
+  }
+
+  // Draws the pixel of every step-th row and column as step x step blocks.
+  // Normalizes like normalizeLastData() but over these pixel and without
+  // changing lastData, the next passes build on it.
+  template <COLORING Coloring> void drawPreview(int step) {
+    double min = 0.;
+    double multiply = 1.;
+    if (normalise_mandelbrot_iterations) {
+      double max = 0.;
+      min = mandelbrot.getMaxIterations();
+      for (int row = 0; row < resolution_y; row += step) {
+        for (int col = 0; col < resolution_x; col += step) {
+          max = std::max(max, lastData(col, row));
+          min = std::min(min, lastData(col, row));
+        }
+      }
+      if (max > min) {
+        multiply = mandelbrot.getMaxIterations() / (max - min);
+      } else {
+        min = 0.;
       }
     }
+    std::vector<unsigned char> rgb(3 * resolution_x);
+    for (int row = 0; row < resolution_y; row++) {
+      // the rows between keep the colors of the one above
+      if (row % step == 0) {
+        for (int col = 0; col < resolution_x; col += step) {
+          unsigned char *block = &rgb[3 * col];
+          colorize<Coloring>((lastData(col, row) - min) * multiply, block);
+          for (int i = 1; i < step && col + i < resolution_x; i++) {
+            std::copy(block, block + 3, block + 3 * i);
+          }
+        }
+      }
+      setPixelRow(row, rgb.data(), resolution_x);
+    }
+  }
+
+  template <COLORING Coloring>
+  void colorize(double value, unsigned char *rgb) {
+    if (Coloring == COLORING::COS) {
+      mandelbrot.mandelbrotCOS(value, rgb);
+    } else {
+      mandelbrot.mandelbrotSPLINE(value, rgb);
+    }
+  }
+
+  // Finds the pixel which differ sharply from a neighbour and calculates the
+  // subsamples of them in parallel, see setAntiAliasing().
+  void antiAlias() {
+    const int size_x = getWindowSizeX();
+    const int size_y = getWindowSizeY();
+    const double max_iterations = mandelbrot.getMaxIterations();
+    // the smooth result is iterations * max_iterations
+    const double to_iterations =
+        mandelbrot.getSmoothing() ? 1. / max_iterations : 1.;
+
+    std::vector<char> edge(size_x * size_y, 0);
+    for (int y = 0; y < size_y; y++) {
+      for (int x = 0; x < size_x; x++) {
+        const double iterations = lastData(x, y) * to_iterations;
+        if (x + 1 < size_x &&
+            std::abs(lastData(x + 1, y) * to_iterations - iterations) >
+                ANTI_ALIASING_EDGE_DIFFERENCE) {
+          edge[y * size_x + x] = 1;
+          edge[y * size_x + x + 1] = 1;
+        }
+        if (y + 1 < size_y &&
+            std::abs(lastData(x, y + 1) * to_iterations - iterations) >
+                ANTI_ALIASING_EDGE_DIFFERENCE) {
+          edge[y * size_x + x] = 1;
+          edge[(y + 1) * size_x + x] = 1;
+        }
+      }
+    }
+    anti_aliased_pixel.clear();
+    for (int i = 0; i < size_x * size_y; i++) {
+      if (edge[i]) {
+        anti_aliased_pixel.push_back(i);
+      }
+    }
+    anti_aliasing_samples.resize(anti_aliased_pixel.size() * anti_aliasing *
+                                 anti_aliasing);
+
+    const int num_pixel = static_cast<int>(anti_aliased_pixel.size());
+    multithreadManager.reset(ANTI_ALIASING_PACKET_SIZE, num_pixel);
+    if (num_threads > 1) {
+      thread_pool.run(num_threads,
+                      [this](int) { calculateAntiAliasingSamples(); });
+    } else {
+      calculateAntiAliasingSamples();
+    }
+  }
+
+  void calculateAntiAliasingSamples() {
+    const int size_x = getWindowSizeX();
+    const int k = anti_aliasing;
+    const Eigen::Vector2d offset = coordinateOffset();
+    std::vector<double> re, im;
+    Eigen::Vector2d world;
+    int from, to;
+    while (multithreadManager.getNextPackage(from, to)) {
+      re.clear();
+      im.clear();
+      for (int p = from; p < to; p++) {
+        const int pixel = anti_aliased_pixel[p];
+        const int x = pixel % size_x;
+        const int y = pixel / size_x;
+        // one jittered sample in each cell of a k x k grid over the pixel
+        for (int s = 0; s < k * k; s++) {
+          const std::uint64_t key =
+              (static_cast<std::uint64_t>(pixel) * k * k + s) * 2;
+          const double dx = (s % k + jitter(key)) / k - 0.5;
+          const double dy = (s / k + jitter(key + 1)) / k - 0.5;
+          planar_transformation.transformToWorld(
+              Eigen::Vector2d(x + dx, y + dy), world);
+          re.push_back(offset.x() + world.x());
+          im.push_back(offset.y() + world.y());
+        }
+      }
+      calculateCoordinates(re, im, &anti_aliasing_samples[from * k * k]);
+    }
+  }
+
+  // Uniform in [0, 1) and the same for every frame, so a still view does not
+  // flicker between frames. splitmix64 of the key.
+  static double jitter(std::uint64_t key) {
+    key += 0x9e3779b97f4a7c15ULL;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return static_cast<double>(key >> 11) / 9007199254740992.;
   }
 
   void threadedMainLoop() {
+    // whichever thread started it may be pinned
+    hw::unpinCurrentThread();
     while (isRunning()) {
+      applyRequestedView();
       if (need_update) {
+        // Any change from now on needs another frame and cancels this one. A
+        // burst of changes costs one frame of the latest state.
+        need_update = false;
         timer.start();
+        cancellable_frame = true;
+        last_poll = std::chrono::steady_clock::now();
         calculateImage(false);
+        cancellable_frame = false;
+        if (frame_cancelled) {
+          continue;
+        }
         timer.stop();
         std::cout << timer << std::endl;
-        need_update = false;
         updateImage();
       } else {
+        if (save_picture) {
+          save_picture = false;
+          saveCurrentImage();
+        }
         userInteractions();
+        // keep the Buddhabrot converging between the user interactions, in
+        // slices so they are not delayed until a round is finished
+        if (!need_update && rendering == RENDERING::BUDDHABROT &&
+            buddhabrot_round < BUDDHABROT_ROUNDS &&
+            refineBuddhabrot(BUDDHABROT_SLICE_MS)) {
+          updateImage();
+        }
       }
     }
   }
 
-  void calculateImageMultiThreaded() {
-    const int size_vertical = getWindowSizeY();
-    Eigen::Vector2d mandelbrotCoordinates;
+  void startBuddhabrot() {
+    const int size_x = getWindowSizeX();
+    const int size_y = getWindowSizeY();
+    Eigen::Vector2d corner0, corner1;
+    planar_transformation.transformToWorld(Eigen::Vector2d(0, 0), corner0);
+    planar_transformation.transformToWorld(imageSize(), corner1);
+    corner0 += world_origin;
+    corner1 += world_origin;
+    buddhabrot.setView(corner0.x(),
+                       corner0.y(),
+                       corner1.x(),
+                       corner1.y(),
+                       size_x,
+                       size_y);
+    buddhabrot.setMaxIterations(mandelbrot.getMaxIterations());
+    buddhabrot.setFormula(mandelbrot.getFormula());
+    buddhabrot_histogram.assign(size_x * size_y, 0);
+    buddhabrot_thread_histogram.assign(
+        num_threads, std::vector<unsigned int>(size_x * size_y, 0));
+    buddhabrot_random.clear();
+    for (int t = 0; t < num_threads; t++) {
+      buddhabrot_random.push_back(func::RandomStream(BUDDHABROT_SEED, t));
+    }
+    buddhabrot_sampled.assign(num_threads, 0);
+    buddhabrot_round_escaped.assign(num_threads, 0);
+    buddhabrot_round = 0;
+    buddhabrot_orbits = 0;
+    buddhabrot_escaped = 0;
+    buddhabrot_seconds = 0.;
+  }
+
+  // Continues the current round for at most slice_ms or until the frame is
+  // cancelled: every thread samples into its own histogram with its own
+  // random stream in batches of BUDDHABROT_BATCH. Once all threads finished
+  // their part of the round, the histograms are added to the total and the
+  // image is drawn. Returns true then. The result does not depend on the
+  // slices.
+  bool refineBuddhabrot(double slice_ms) {
+    const int size_x = getWindowSizeX();
+    const int size_y = getWindowSizeY();
+    const long samples_per_thread =
+        static_cast<long>(size_x) * size_y / num_threads;
+    const auto start = std::chrono::steady_clock::now();
+    thread_pool.run(num_threads, [&](int t) {
+      while (buddhabrot_sampled[t] < samples_per_thread &&
+             !frameCancelled(t) &&
+             std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start)
+                     .count() < slice_ms) {
+        const long batch = std::min(BUDDHABROT_BATCH,
+                                    samples_per_thread - buddhabrot_sampled[t]);
+        buddhabrot_round_escaped[t] +=
+            buddhabrot.sample(buddhabrot_random[t],
+                              batch,
+                              buddhabrot_thread_histogram[t]);
+        buddhabrot_sampled[t] += batch;
+      }
+    });
+    buddhabrot_seconds += std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+    for (int t = 0; t < num_threads; t++) {
+      if (buddhabrot_sampled[t] < samples_per_thread) {
+        return false;
+      }
+    }
+    for (int t = 0; t < num_threads; t++) {
+      std::vector<unsigned int> &histogram = buddhabrot_thread_histogram[t];
+      for (size_t i = 0; i < histogram.size(); i++) {
+        buddhabrot_histogram[i] += histogram[i];
+      }
+      std::fill(histogram.begin(), histogram.end(), 0);
+      buddhabrot_escaped += buddhabrot_round_escaped[t];
+      buddhabrot_round_escaped[t] = 0;
+      buddhabrot_sampled[t] = 0;
+    }
+    buddhabrot_orbits += samples_per_thread * num_threads;
+    buddhabrot_round++;
+
+    // The density spans several magnitudes, the square root keeps the faint
+    // orbits visible.
+    for (int y = 0; y < size_y; y++) {
+      for (int x = 0; x < size_x; x++) {
+        lastData(x, y) = std::sqrt(
+            static_cast<double>(buddhabrot_histogram[y * size_x + x]));
+      }
+    }
+    normalizeLastData();
+    drawAllPixel();
+
+    std::cout << "buddhabrot: round " << buddhabrot_round << ", "
+              << buddhabrot_orbits << " orbits, " << buddhabrot_escaped
+              << " escaped, "
+              << buddhabrot_orbits / (buddhabrot_seconds * num_threads)
+              << " orbits/s per core" << std::endl;
+    return true;
+  }
+
+  // Times the tiled pass over the current view for a few tile sizes and keeps
+  // the fastest one.
+  void calibrateTileSize() {
+    if (num_threads <= 1) {
+      return;
+    }
+    // sets up the state of the frame like the precision
+    calculateImage(false);
+    // every pixel is calculated from scratch, see calculateRowSegment()
+    interval_culling_active = false;
+    known_pixel_active = false;
+    resume_active = false;
+    resuming = false;
+    constexpr int CANDIDATES[] = {16, 32, 64, 128, 256};
+    constexpr int REPETITIONS = 3;
+    double best_seconds = std::numeric_limits<double>::max();
+    std::cout << "tile size calibration (ms):";
+    for (const int candidate : CANDIDATES) {
+      double seconds = std::numeric_limits<double>::max();
+      for (int r = 0; r < REPETITIONS; r++) {
+        tile_scheduler.reset(
+            getWindowSizeX(), getWindowSizeY(), candidate, num_threads);
+        thread_pool.run(num_threads,
+                        [this](int t) { calculateImageMultiThreaded(t); });
+        tile_scheduler.finish();
+        seconds = std::min(seconds, tile_scheduler.seconds);
+      }
+      std::cout << " " << candidate << ": " << seconds * 1e3;
+      if (seconds < best_seconds) {
+        best_seconds = seconds;
+        tile_size = candidate;
+      }
+    }
+    std::cout << ", using " << tile_size << std::endl;
+    need_update = true;
+  }
+
+  // Allocates lastData anew and has every thread zero the tiles it starts
+  // with in the tiled pass. The pages of a tile are placed on the NUMA node of
+  // the thread which touches them first. Only lastData, std::vector zeroes
+  // its elements in the thread which allocates it.
+  void touchFrameBuffer() {
+    lastData = Eigen::MatrixXd();
+    lastData.resize(getWindowSizeX(), getWindowSizeY());
+    tile_scheduler.reset(
+        getWindowSizeX(), getWindowSizeY(), tile_size, num_threads);
+    thread_pool.run(num_threads, [this](int t) {
+      const TileScheduler::Worker &worker = tile_scheduler.workers[t];
+      for (int tile = worker.begin; tile < worker.end; tile++) {
+        const PixelRect rect = tile_scheduler.tileRect(tile);
+        for (int y = rect.y0; y <= rect.y1; y++) {
+          std::fill(&lastData(rect.x0, y), &lastData(rect.x1, y) + 1, 0.);
+        }
+      }
+    });
+    need_update = true;
+  }
+
+  // Calculates the pixel of every step-th row and column which are not known
+  // yet and marks them in known_pixel.
+  void calculatePreview(int step) {
+    // one package is one row of the preview
+    multithreadManager.reset(1, (getWindowSizeY() + step - 1) / step);
+    if (num_threads > 1) {
+      thread_pool.run(num_threads,
+                      [this, step](int t) { calculatePreviewRows(t, step); });
+    } else {
+      calculatePreviewRows(0, step);
+    }
+  }
+
+  void calculatePreviewRows(int worker, int step) {
+    const int size_x = getWindowSizeX();
+    const int columns = (size_x + step - 1) / step;
+    std::vector<double> re, im, unknown_re, unknown_im, result;
+    std::vector<int> unknown_x;
     int from, to;
+    while (!frameCancelled(worker) &&
+           multithreadManager.getNextPackage(from, to)) {
+      for (int y = from * step; y < to * step; y += step) {
+        fillCoordinates(0, y, step, 0, columns, re, im);
+        char *known = &known_pixel[y * size_x];
+        unknown_x.clear();
+        unknown_re.clear();
+        unknown_im.clear();
+        for (int i = 0; i < columns; i++) {
+          if (!known[i * step]) {
+            unknown_x.push_back(i * step);
+            unknown_re.push_back(re[i]);
+            unknown_im.push_back(im[i]);
+          }
+        }
+        result.resize(unknown_x.size());
+        calculateCoordinates(unknown_re, unknown_im, result.data());
+        for (size_t i = 0; i < unknown_x.size(); i++) {
+          lastData(unknown_x[i], y) = result[i];
+          known[unknown_x[i]] = 1;
+        }
+      }
+    }
+  }
 
-    while (multithreadManager.getNextPackage(from, to)) {
-      for (int i = from; i < to; i++) {
-        const int x = i / size_vertical;
-        const int y = i % size_vertical;
-        const Eigen::Vector2d imageCoordinates(x, y);
+  // True if a newer state was requested while an interactive frame is
+  // calculated. The passes stop at their next tile or packet then. Worker 0 is
+  // the thread of threadedMainLoop(), it polls the user input meanwhile.
+  bool frameCancelled(int worker) {
+    if (!cancellable_frame) {
+      return false;
+    }
+    if (worker == 0) {
+      const auto now = std::chrono::steady_clock::now();
+      if (std::chrono::duration<double, std::milli>(now - last_poll).count() >
+          EVENT_POLL_MS) {
+        last_poll = now;
+        pollEvents();
+      }
+    }
+    return need_update || zoom || step_back;
+  }
 
-        planar_transformation.transformToWorld(imageCoordinates,
-                                               mandelbrotCoordinates);
-        const int iterations = mandelbrot.mandelbrot(mandelbrotCoordinates);
-        lastData(x, y) = iterations;
+  // Leaves the rest of the frame. lastData is incomplete, so it is not drawn.
+  void cancelFrame() {
+    frame_cancelled = true;
+    cancelled_frames++;
+    // the state of the pixel was partly advanced
+    if (resume_active) {
+      resume_iterations = 0;
+    }
+  }
+
+  void calculateImageMultiThreaded(int worker) {
+    std::vector<double> re, im, result;
+    PixelRect tile;
+    double &busy_seconds = tile_scheduler.workers[worker].busy_seconds;
+    while (!frameCancelled(worker) &&
+           tile_scheduler.getNextTile(worker, tile)) {
+      const auto start = std::chrono::steady_clock::now();
+      for (int y = tile.y0; y <= tile.y1; y++) {
+        calculateRowSegment(
+            tile.x0, y, tile.x1 - tile.x0 + 1, re, im, result);
       }
+      busy_seconds += std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
     }
   }
 
   void calculateImageSingleThreaded() {
+    std::vector<double> re, im, result;
+    for (int y = 0; y < getWindowSizeY() && !frameCancelled(0); y++) {
+      calculateRowSegment(0, y, getWindowSizeX(), re, im, result);
+    }
+  }
+
+  // Calculates the pixel [x, x + length) of row y with the vectorized kernel.
+  // re, im and result are buffers to avoid allocations for each segment.
+  void calculateRowSegment(int x,
+                           int y,
+                           int length,
+                           std::vector<double> &re,
+                           std::vector<double> &im,
+                           std::vector<double> &result) {
+    if (num_mirrored_rows > 0 && mirror_row[y] >= 0) {
+      // see copyMirroredRows()
+      return;
+    }
+    if (!known_pixel_active && !resuming) {
+      fillCoordinates(x, y, 1, 0, length, re, im);
+      calculateRun(x, y, re, im);
+      return;
+    }
+    if (progressive_passes > 0) {
+      // The previews leave single pixel between the known ones, gathering
+      // them keeps the vector lanes busy. There is no resume state to keep,
+      // see calculateImage().
+      fillCoordinates(x, y, 1, 0, length, re, im);
+      const char *known = &known_pixel[y * getWindowSizeX() + x];
+      int n = 0;
+      for (int i = 0; i < length; i++) {
+        if (!known[i]) {
+          re[n] = re[i];
+          im[n] = im[i];
+          n++;
+        }
+      }
+      re.resize(n);
+      im.resize(n);
+      result.resize(n);
+      calculateCoordinates(re, im, result.data());
+      for (int i = 0, j = 0; j < n; i++) {
+        if (!known[i]) {
+          lastData(x + i, y) = result[j++];
+        }
+      }
+      return;
+    }
+    // only the runs of pixel not known from cullTiles() or the previews or the
+    // unresolved ones if resuming
+    const int row = y * getWindowSizeX();
+    const auto skip = [&](int i) {
+      return resuming ? resume_unresolved[row + i] == 0
+                      : known_pixel[row + i] != 0;
+    };
+    const int end = x + length;
+    while (x < end) {
+      if (skip(x)) {
+        x++;
+        continue;
+      }
+      int run_end = x;
+      while (run_end < end && !skip(run_end)) {
+        run_end++;
+      }
+      fillCoordinates(x, y, 1, 0, run_end - x, re, im);
+      calculateRun(x, y, re, im);
+      x = run_end;
+    }
+  }
+
+  // Calculates the pixel starting at (x, y) of the coordinates re and im and
+  // keeps their state if resume_active.
+  void calculateRun(int x,
+                    int y,
+                    const std::vector<double> &re,
+                    const std::vector<double> &im) {
+    // lastData is column major with x as row index, so one image row is
+    // continuous in memory. The state has the same layout.
+    double *result = &lastData(x, y);
+    if (!resume_active) {
+      calculateCoordinates(re, im, result);
+      return;
+    }
+    const int n = static_cast<int>(re.size());
+    const int i = y * getWindowSizeX() + x;
+    if (resuming) {
+      num_resumed_pixel += n;
+    }
+    const unsigned int start = resuming ? resume_from : 0;
+    if (frame_precision == PRECISION::FLOAT) {
+      mandelbrot.mandelbrotSinglePrecision(re.data(),
+                                           im.data(),
+                                           n,
+                                           start,
+                                           &resume_zr[i],
+                                           &resume_zi[i],
+                                           &resume_saved_zr[i],
+                                           &resume_saved_zi[i],
+                                           &resume_unresolved[i],
+                                           result);
+    } else {
+      mandelbrot.mandelbrot(re.data(),
+                            im.data(),
+                            n,
+                            start,
+                            &resume_zr[i],
+                            &resume_zi[i],
+                            &resume_saved_zr[i],
+                            &resume_saved_zi[i],
+                            &resume_unresolved[i],
+                            result);
+    }
+  }
+
+  // Same as calculateRowSegment but for [y, y + length) of column x.
+  void calculateColumnSegment(int x,
+                              int y,
+                              int length,
+                              std::vector<double> &re,
+                              std::vector<double> &im,
+                              std::vector<double> &result) {
+    fillCoordinates(x, y, 0, 1, length, re, im);
+    result.resize(length);
+    calculateCoordinates(re, im, result.data());
+    for (int i = 0; i < length; i++) {
+      // culled pixel are exact already, see cullTiles()
+      if (!known_pixel_active ||
+          !known_pixel[(y + i) * getWindowSizeX() + x]) {
+        lastData(x, y + i) = result[i];
+      }
+    }
+  }
+
+  // Collects all pixel to calculate, iterates them up to a limit, keeps the
+  // ones which did not escape and repeats with twice the limit until the list
+  // is empty or the limit of the frame is reached. The survivors keep their Z,
+  // so no iteration is done twice.
+  void calculateImageStaged() {
+    const int size_x = getWindowSizeX();
+    const unsigned int max_iterations = mandelbrot.getMaxIterations();
+    unsigned int start = resuming ? resume_from : 0;
+
+    stage_pixel.clear();
+    stage_re.clear();
+    stage_im.clear();
+    stage_zr.clear();
+    stage_zi.clear();
+    stage_saved_zr.clear();
+    stage_saved_zi.clear();
+    std::vector<double> re, im;
+    for (int y = 0; y < getWindowSizeY(); y++) {
+      if (num_mirrored_rows > 0 && mirror_row[y] >= 0) {
+        continue;
+      }
+      fillCoordinates(0, y, 1, 0, size_x, re, im);
+      for (int x = 0; x < size_x; x++) {
+        const int i = y * size_x + x;
+        if ((known_pixel_active && known_pixel[i]) ||
+            (resuming && !resume_unresolved[i])) {
+          continue;
+        }
+        stage_pixel.push_back(i);
+        stage_re.push_back(re[x]);
+        stage_im.push_back(im[x]);
+        stage_zr.push_back(resuming ? resume_zr[i] : 0.);
+        stage_zi.push_back(resuming ? resume_zi[i] : 0.);
+        stage_saved_zr.push_back(resuming ? resume_saved_zr[i] : 0.);
+        stage_saved_zi.push_back(resuming ? resume_saved_zi[i] : 0.);
+      }
+    }
+
+    stage_survivors.clear();
+    double *data = lastData.data();
+    const bool smoothing = mandelbrot.getSmoothing();
+    while (!stage_pixel.empty() && start < max_iterations) {
+      const unsigned int limit =
+          std::min(max_iterations, std::max(STAGE_ITERATIONS, 2 * start));
+      const int n = static_cast<int>(stage_pixel.size());
+      stage_survivors.push_back(n);
+      stage_unresolved.resize(n);
+      stage_result.resize(n);
+      mandelbrot.setMaxIterations(limit);
+      multithreadManager.reset(STAGE_PACKET_SIZE, n);
+      if (num_threads > 1) {
+        thread_pool.run(num_threads, [this, start](int t) {
+          calculateStagePackets(t, start);
+        });
+      } else {
+        calculateStagePackets(0, start);
+      }
+      if (frameCancelled(0)) {
+        // the results of the stage are incomplete
+        break;
+      }
+
+      // Write the resolved pixel, move the survivors to the front. The results
+      // are relative to the limit of the stage like in prepareResume().
+      const bool last_stage = limit == max_iterations;
+      const double scale = static_cast<double>(max_iterations) / limit;
+      int survivors = 0;
+      for (int k = 0; k < n; k++) {
+        const int i = stage_pixel[k];
+        if (stage_unresolved[k] && !last_stage) {
+          stage_pixel[survivors] = i;
+          stage_re[survivors] = stage_re[k];
+          stage_im[survivors] = stage_im[k];
+          stage_zr[survivors] = stage_zr[k];
+          stage_zi[survivors] = stage_zi[k];
+          stage_saved_zr[survivors] = stage_saved_zr[k];
+          stage_saved_zi[survivors] = stage_saved_zi[k];
+          survivors++;
+          continue;
+        }
+        double value = stage_result[k];
+        if (smoothing) {
+          value *= scale;
+        } else if (value == limit) {
+          value = max_iterations;
+        }
+        data[i] = value;
+        if (resume_active) {
+          resume_zr[i] = stage_zr[k];
+          resume_zi[i] = stage_zi[k];
+          resume_saved_zr[i] = stage_saved_zr[k];
+          resume_saved_zi[i] = stage_saved_zi[k];
+          resume_unresolved[i] = stage_unresolved[k];
+        }
+      }
+      stage_pixel.resize(survivors);
+      stage_re.resize(survivors);
+      stage_im.resize(survivors);
+      stage_zr.resize(survivors);
+      stage_zi.resize(survivors);
+      stage_saved_zr.resize(survivors);
+      stage_saved_zi.resize(survivors);
+      start = limit;
+    }
+    mandelbrot.setMaxIterations(max_iterations);
+    if (resuming) {
+      num_resumed_pixel = stage_survivors.empty() ? 0 : stage_survivors[0];
+    }
+  }
+
+  void calculateStagePackets(int worker, unsigned int start) {
+    int from, to;
+    while (!frameCancelled(worker) &&
+           multithreadManager.getNextPackage(from, to)) {
+      if (frame_precision == PRECISION::FLOAT) {
+        mandelbrot.mandelbrotSinglePrecision(&stage_re[from],
+                                             &stage_im[from],
+                                             to - from,
+                                             start,
+                                             &stage_zr[from],
+                                             &stage_zi[from],
+                                             &stage_saved_zr[from],
+                                             &stage_saved_zi[from],
+                                             &stage_unresolved[from],
+                                             &stage_result[from]);
+      } else {
+        mandelbrot.mandelbrot(&stage_re[from],
+                              &stage_im[from],
+                              to - from,
+                              start,
+                              &stage_zr[from],
+                              &stage_zi[from],
+                              &stage_saved_zr[from],
+                              &stage_saved_zi[from],
+                              &stage_unresolved[from],
+                              &stage_result[from]);
+      }
+    }
+  }
+
+  // The set is symmetric to the real axis: c and its conjugate give bit
+  // identical results in all kernels except perturbation and in all formulas
+  // except the burning ship. Finds the rows
+  // below the real axis which mirror a row above it. Mirrors which are not
+  // closer than MAX_OFFSET pixel to a row are calculated.
+  void findMirroredRows() {
+    constexpr double MAX_OFFSET = 0.01;
+    const int size_y = getWindowSizeY();
+    mirror_row.assign(size_y, -1);
+    num_mirrored_rows = 0;
+    // The deep zoom tiers do not pass absolute coordinates and a view
+    // straddling the real axis is never deep anyway.
+    if (!symmetry || rendering != RENDERING::PIXEL_WISE ||
+        !formula::isConjugateSymmetric(mandelbrot.getFormula()) ||
+        !(frame_precision == PRECISION::FLOAT ||
+          frame_precision == PRECISION::MIXED ||
+          frame_precision == PRECISION::DOUBLE)) {
+      return;
+    }
+    const double last_x = getWindowSizeX() - 1;
+    for (int y = 0; y < size_y; y++) {
+      Eigen::Vector2d first, last;
+      planar_transformation.transformToWorld(Eigen::Vector2d(0, y), first);
+      planar_transformation.transformToWorld(Eigen::Vector2d(last_x, y), last);
+      if (first.y() + world_origin.y() >= 0.) {
+        continue;
+      }
+      // the conjugate of the first pixel in the image
+      Eigen::Vector2d mirror;
+      planar_transformation.transformToPicture(
+          Eigen::Vector2d(first.x(), -first.y() - 2. * world_origin.y()),
+          mirror);
+      const int source = static_cast<int>(std::round(mirror.y()));
+      if (source < 0 || source >= size_y ||
+          std::abs(mirror.y() - source) > MAX_OFFSET ||
+          std::abs(mirror.x()) > MAX_OFFSET) {
+        continue;
+      }
+      // a rotated view has no mirrored rows
+      Eigen::Vector2d last_mirror;
+      planar_transformation.transformToPicture(
+          Eigen::Vector2d(last.x(), -last.y() - 2. * world_origin.y()),
+          last_mirror);
+      if (std::abs(last_mirror.y() - source) > MAX_OFFSET ||
+          std::abs(last_mirror.x() - last_x) > MAX_OFFSET) {
+        continue;
+      }
+      mirror_row[y] = source;
+      num_mirrored_rows++;
+    }
+  }
+
+  void copyMirroredRows() {
+    if (num_mirrored_rows == 0) {
+      return;
+    }
+    for (int y = 0; y < getWindowSizeY(); y++) {
+      if (mirror_row[y] >= 0) {
+        // lastData is column major with x as row index
+        lastData.col(y) = lastData.col(mirror_row[y]);
+        if (resume_active) {
+          const int size_x = getWindowSizeX();
+          const int to = y * size_x;
+          const int from = mirror_row[y] * size_x;
+          std::copy_n(&resume_zr[from], size_x, &resume_zr[to]);
+          std::copy_n(&resume_zi[from], size_x, &resume_zi[to]);
+          std::copy_n(&resume_saved_zr[from], size_x, &resume_saved_zr[to]);
+          std::copy_n(&resume_saved_zi[from], size_x, &resume_saved_zi[to]);
+          std::copy_n(&resume_unresolved[from], size_x, &resume_unresolved[to]);
+        }
+      }
+    }
+  }
+
+  // The view of the stored state, see canResume().
+  std::vector<double> resumeView() const {
+    Eigen::Vector2d corner1, corner2;
+    planar_transformation.transformToWorld(Eigen::Vector2d(0, 0), corner1);
+    planar_transformation.transformToWorld(imageSize(), corner2);
+    return {corner1.x(),
+            corner1.y(),
+            corner2.x(),
+            corner2.y(),
+            world_origin.x(),
+            world_origin.y(),
+            static_cast<double>(getWindowSizeX()),
+            static_cast<double>(getWindowSizeY()),
+            static_cast<double>(frame_precision),
+            mandelbrot.getSmoothing() ? 1. : 0.,
+            mandelbrot.getPeriodicityCheck() ? 1. : 0.};
+  }
+
+  // True if the stored state belongs to the same view with a lower iteration
+  // limit.
+  bool canResume() const {
+    return resume_iterations > 0 &&
+           resume_iterations < mandelbrot.getMaxIterations() &&
+           resume_view == resumeView();
+  }
+
+  // Restores the raw data of the last frame and adapts the resolved pixel to
+  // the new iteration limit. The unresolved ones are calculated again.
+  void prepareResume() {
+    resume_from = resume_iterations;
+    lastData = resume_data;
+    const double max_iterations = mandelbrot.getMaxIterations();
+    const double old_max_iterations = resume_iterations;
+    const bool smoothing = mandelbrot.getSmoothing();
+    double *data = lastData.data();
+    for (size_t i = 0; i < resume_unresolved.size(); i++) {
+      if (resume_unresolved[i]) {
+        continue;
+      }
+      if (smoothing) {
+        // the smooth value is proportional to the limit, see
+        // Mandelbrot::mandelbrot_smooth()
+        data[i] *= max_iterations / old_max_iterations;
+      } else if (data[i] == old_max_iterations) {
+        // inside or periodic
+        data[i] = max_iterations;
+      }
+    }
+  }
+
+  void storeResumeState() {
+    resume_data = lastData;
+    resume_iterations = mandelbrot.getMaxIterations();
+    resume_view = resumeView();
+  }
+
+  // Fills the tiles for which Mandelbrot::classifyTile() proves a uniform
+  // result and marks their pixel in known_pixel.
+  void cullTiles() {
+    constexpr int TILE_SIZE = 16;
+    const int size_x = getWindowSizeX();
+    const int size_y = getWindowSizeY();
+    const int tiles_y = (size_y + TILE_SIZE - 1) / TILE_SIZE;
+    num_tiles = ((size_x + TILE_SIZE - 1) / TILE_SIZE) * tiles_y;
+    culled_tiles_inside = 0;
+    culled_tiles_escaped = 0;
+    known_pixel.assign(size_x * size_y, 0);
+
+    // one package is one row of tiles
+    multithreadManager.reset(1, tiles_y);
+    if (num_threads > 1) {
+      thread_pool.run(num_threads, [this](int) { cullTileRows(TILE_SIZE); });
+    } else {
+      cullTileRows(TILE_SIZE);
+    }
+  }
+
+  void cullTileRows(int tile_size) {
+    const int size_x = getWindowSizeX();
+    const int size_y = getWindowSizeY();
+    // The pixel coordinates are rounded by fillCoordinates(), the margin must
+    // cover that. Double frames stop far above the double resolution.
+    const double margin = 1e-3 / std::abs(getCurrentWorldZoom());
+    int from, to;
+    while (multithreadManager.getNextPackage(from, to)) {
+      for (int y0 = from * tile_size; y0 < to * tile_size && y0 < size_y;
+           y0 += tile_size) {
+        const int y1 = std::min(y0 + tile_size, size_y) - 1;
+        for (int x0 = 0; x0 < size_x; x0 += tile_size) {
+          const int x1 = std::min(x0 + tile_size, size_x) - 1;
+          Eigen::Vector2d corner1, corner2;
+          planar_transformation.transformToWorld(Eigen::Vector2d(x0, y0),
+                                                 corner1);
+          planar_transformation.transformToWorld(Eigen::Vector2d(x1, y1),
+                                                 corner2);
+          corner1 += world_origin;
+          corner2 += world_origin;
+          const Interval re(std::min(corner1.x(), corner2.x()) - margin,
+                            std::max(corner1.x(), corner2.x()) + margin);
+          const Interval im(std::min(corner1.y(), corner2.y()) - margin,
+                            std::max(corner1.y(), corner2.y()) + margin);
+
+          double value;
+          const Mandelbrot::TILE tile = mandelbrot.classifyTile(re, im, value);
+          if (tile == Mandelbrot::TILE_UNKNOWN) {
+            continue;
+          }
+          if (tile == Mandelbrot::TILE_INSIDE) {
+            culled_tiles_inside++;
+          } else {
+            culled_tiles_escaped++;
+          }
+          lastData.block(x0, y0, x1 - x0 + 1, y1 - y0 + 1).setConstant(value);
+          for (int y = y0; y <= y1; y++) {
+            std::fill(&known_pixel[y * size_x + x0],
+                      &known_pixel[y * size_x + x1] + 1,
+                      1);
+          }
+        }
+      }
+    }
+  }
+
+  // Fills re and im with the coordinates of the pixel (x + i * dx, y + i * dy)
+  // as needed by calculateCoordinates().
+  void fillCoordinates(int x,
+                       int y,
+                       int dx,
+                       int dy,
+                       int length,
+                       std::vector<double> &re,
+                       std::vector<double> &im) const {
+    re.resize(length);
+    im.resize(length);
+    const Eigen::Vector2d offset = coordinateOffset();
     Eigen::Vector2d mandelbrotCoordinates;
-    for (int x = 0; x < DEFAULT_RESOLUTION_X; x++) {
-      for (int y = 0; y < DEFAULT_RESOLUTION_Y; y++) {
-        const Eigen::Vector2d imageCoordinates(x, y);
-        planar_transformation.transformToWorld(imageCoordinates,
-                                               mandelbrotCoordinates);
+    for (int i = 0; i < length; i++) {
+      const Eigen::Vector2d imageCoordinates(x + i * dx, y + i * dy);
+      planar_transformation.transformToWorld(imageCoordinates,
+                                             mandelbrotCoordinates);
+      re[i] = offset.x() + mandelbrotCoordinates.x();
+      im[i] = offset.y() + mandelbrotCoordinates.y();
+    }
+  }
+
+  // Added to the world coordinates of planar_transformation to get the
+  // coordinates calculateCoordinates() expects for the frame precision.
+  Eigen::Vector2d coordinateOffset() const {
+    // Perturbation needs the difference to the reference, double the absolute
+    // world position.
+    if (frame_precision == PRECISION::PERTURBATION) {
+      return -perturbation_reference;
+    }
+    if (frame_precision == PRECISION::DOUBLE_DOUBLE ||
+        frame_precision == PRECISION::FIXED_POINT) {
+      // world_origin_dd/fp is added in double-double/fixed point
+      return Eigen::Vector2d(0, 0);
+    }
+    return world_origin;
+  }
+
+  void calculateCoordinates(const std::vector<double> &re,
+                            const std::vector<double> &im,
+                            double *result) const {
+    const int n = static_cast<int>(re.size());
+    if (frame_precision == PRECISION::PERTURBATION) {
+      perturbation.mandelbrot(re.data(), im.data(), n, result);
+    } else if (frame_precision == PRECISION::DOUBLE_DOUBLE) {
+      mandelbrot.mandelbrot(world_origin_dd_re,
+                            world_origin_dd_im,
+                            re.data(),
+                            im.data(),
+                            n,
+                            result);
+    } else if (frame_precision == PRECISION::FIXED_POINT) {
+      mandelbrot.mandelbrot(world_origin_fp_re,
+                            world_origin_fp_im,
+                            re.data(),
+                            im.data(),
+                            n,
+                            result);
+    } else if (frame_precision == PRECISION::FLOAT ||
+               frame_precision == PRECISION::MIXED) {
+      mandelbrot.mandelbrotSinglePrecision(re.data(), im.data(), n, result);
+    } else {
+      mandelbrot.mandelbrot(re.data(), im.data(), n, result);
+    }
+  }
+
+  // The center of the view is the reference for all pixel.
+  void calculatePerturbationReference() {
+    Eigen::Vector2d corner;
+    planar_transformation.transformToWorld(imageSize() * 0.5,
+                                           perturbation_reference);
+    planar_transformation.transformToWorld(Eigen::Vector2d(0, 0), corner);
+    const double radius = (corner - perturbation_reference).norm();
+
+    perturbation.setMaxIterations(mandelbrot.getMaxIterations());
+    perturbation.setSmoothing(mandelbrot.getSmoothing());
+    perturbation.resetStatistics();
+    perturbation.setReference(world_origin_re + perturbation_reference.x(),
+                              world_origin_im + perturbation_reference.y(),
+                              radius);
+  }
+
+  // Double coordinates loose their precision if the view is small compared to
+  // its distance to the origin. Therefore the world origin of
+  // planar_transformation is moved into the center of the view after each zoom
+  // and the offset is accumulated in high precision.
+  void recenterWorldOrigin() {
+    Eigen::Vector2d center;
+    planar_transformation.transformToWorld(imageSize() * 0.5, center);
+    planar_transformation.moveWorldOrigin(center);
+    world_origin_re += center.x();
+    world_origin_im += center.y();
+    world_origin = Eigen::Vector2d(world_origin_re.convert_to<double>(),
+                                   world_origin_im.convert_to<double>());
+    world_origin_dd_re = toDoubleDouble(world_origin_re);
+    world_origin_dd_im = toDoubleDouble(world_origin_im);
+    world_origin_fp_re = toFixedPoint(world_origin_re);
+    world_origin_fp_im = toFixedPoint(world_origin_im);
+  }
+
+  static DoubleDouble toDoubleDouble(const Perturbation::Float &f) {
+    const double hi = f.convert_to<double>();
+    const double lo = Perturbation::Float(f - hi).convert_to<double>();
+    return DoubleDouble(hi, lo);
+  }
+
+  // Three doubles hold 159 bits, enough for the 124 fraction bits.
+  static FixedPoint toFixedPoint(const Perturbation::Float &f) {
+    const double hi = f.convert_to<double>();
+    const Perturbation::Float rest = f - hi;
+    const double mid = rest.convert_to<double>();
+    const double lo = Perturbation::Float(rest - mid).convert_to<double>();
+    return FixedPoint(hi) + FixedPoint(mid) + FixedPoint(lo);
+  }
 
-        const int iterations = mandelbrot.mandelbrot(mandelbrotCoordinates);
-        lastData(x, y) = iterations;
+  PRECISION choosePrecision() const {
+    if (precision != PRECISION::AUTOMATIC) {
+      return precision;
+    }
+    // Double has 53 bits, but neighbouring pixel need a few bits to differ
+    // after hundreds of iterations. Double-double would work much deeper, but
+    // perturbation gets faster once the iteration count grows with the depth.
+    // Float has 24 bits which is 2.4e-7 for the coordinates around 2. Mixed
+    // recalculates 5% of the pixel at 1e-3 and 40% at 1e-6.
+    constexpr double MIN_PIXEL_DISTANCE_FLOAT = 1e-3;
+    constexpr double MIN_PIXEL_DISTANCE_MIXED = 1e-5;
+    constexpr double MIN_PIXEL_DISTANCE_DOUBLE = 1e-13;
+    constexpr double MIN_PIXEL_DISTANCE_DOUBLE_DOUBLE = 1e-16;
+    const double pixel_distance = 1. / std::abs(getCurrentWorldZoom());
+    if (pixel_distance > MIN_PIXEL_DISTANCE_FLOAT) {
+      return PRECISION::FLOAT;
+    }
+    if (pixel_distance > MIN_PIXEL_DISTANCE_MIXED) {
+      return PRECISION::MIXED;
+    }
+    if (pixel_distance > MIN_PIXEL_DISTANCE_DOUBLE) {
+      return PRECISION::DOUBLE;
+    }
+    if (pixel_distance > MIN_PIXEL_DISTANCE_DOUBLE_DOUBLE) {
+      return PRECISION::DOUBLE_DOUBLE;
+    }
+    return PRECISION::PERTURBATION;
+  }
+
+  static std::string precisionName(PRECISION p) {
+    switch (p) {
+    case PRECISION::AUTOMATIC:
+      return "automatic";
+    case PRECISION::FLOAT:
+      return "float";
+    case PRECISION::MIXED:
+      return "mixed";
+    case PRECISION::DOUBLE:
+      return "double";
+    case PRECISION::DOUBLE_DOUBLE:
+      return "double-double";
+    case PRECISION::FIXED_POINT:
+      return "fixed point";
+    case PRECISION::PERTURBATION:
+      return "perturbation";
+    }
+    return "unknown";
+  }
+
+  // Finds the pixel of a float frame which are sensitive to the precision and
+  // calculates them again in double.
+  void recalculateImprecisePixel() {
+    const int size_x = getWindowSizeX();
+    const int size_y = getWindowSizeY();
+    // escaped within the last 10% of the iterations
+    constexpr double NEAR_ITERATION_LIMIT = 0.9;
+    constexpr double MAX_NEIGHBOUR_DIFFERENCE = 2.;
+
+    const double max_iterations = mandelbrot.getMaxIterations();
+    const bool smoothing = mandelbrot.getSmoothing();
+    // the smooth result is iterations * max_iterations
+    const double to_iterations = smoothing ? 1. / max_iterations : 1.;
+    const double not_escaped = smoothing ? 0. : max_iterations;
+
+    imprecise_pixel.assign(size_x * size_y, 0);
+    char *imprecise = imprecise_pixel.data();
+    for (int y = 0; y < size_y; y++) {
+      for (int x = 0; x < size_x; x++) {
+        const double value = lastData(x, y);
+        const double iterations = value * to_iterations;
+        if (value != not_escaped &&
+            iterations > NEAR_ITERATION_LIMIT * max_iterations) {
+          imprecise[y * size_x + x] = 1;
+        }
+        if (x + 1 < size_x &&
+            std::abs(lastData(x + 1, y) * to_iterations - iterations) >
+                MAX_NEIGHBOUR_DIFFERENCE) {
+          imprecise[y * size_x + x] = 1;
+          imprecise[y * size_x + x + 1] = 1;
+        }
+        if (y + 1 < size_y &&
+            std::abs(lastData(x, y + 1) * to_iterations - iterations) >
+                MAX_NEIGHBOUR_DIFFERENCE) {
+          imprecise[y * size_x + x] = 1;
+          imprecise[(y + 1) * size_x + x] = 1;
+        }
+      }
+    }
+    const long num_imprecise =
+        std::count(imprecise_pixel.begin(), imprecise_pixel.end(), 1);
+    recalculated_fraction =
+        static_cast<double>(num_imprecise) / imprecise_pixel.size();
+
+    // one package is one image row
+    multithreadManager.reset(1, size_y);
+    if (num_threads > 1) {
+      thread_pool.run(num_threads,
+                      [this](int) { recalculateImprecisePixelRows(); });
+    } else {
+      recalculateImprecisePixelRows();
+    }
+  }
+
+  void recalculateImprecisePixelRows() {
+    const int size_x = getWindowSizeX();
+    std::vector<double> re, im;
+    int from, to;
+    while (multithreadManager.getNextPackage(from, to)) {
+      for (int y = from; y < to; y++) {
+        const char *imprecise = &imprecise_pixel[y * size_x];
+        // imprecise pixel come in runs along the borders
+        int x = 0;
+        while (x < size_x) {
+          if (!imprecise[x]) {
+            x++;
+            continue;
+          }
+          int end = x;
+          while (end < size_x && imprecise[end]) {
+            end++;
+          }
+          fillCoordinates(x, y, 1, 0, end - x, re, im);
+          mandelbrot.mandelbrot(re.data(), im.data(), end - x, &lastData(x, y));
+          x = end;
+        }
       }
     }
   }
 
-  void drawMandelbrotCOS(int x, int y) {
-    const color::RGB<double> rgb = mandelbrot.mandelbrotCOS(lastData(x, y));
-    // function provided by child class
-    setPixelColor(x, y, rgb);
+  void calculateImageMarianiSilver() {
+    const int size_x = getWindowSizeX();
+    const int size_y = getWindowSizeY();
+    computed_pixels = 0;
+    filled_pixels = 0;
+
+    // the border of the image is the border of the first rectangle
+    std::vector<double> re, im, result;
+    calculateRowSegment(0, 0, size_x, re, im, result);
+    calculateRowSegment(0, size_y - 1, size_x, re, im, result);
+    calculateColumnSegment(0, 1, size_y - 2, re, im, result);
+    calculateColumnSegment(size_x - 1, 1, size_y - 2, re, im, result);
+    computed_pixels += 2 * size_x + 2 * (size_y - 2);
+
+    marianiSilverQueue.reset(PixelRect{0, 0, size_x - 1, size_y - 1});
+    if (num_threads > 1) {
+      thread_pool.run(num_threads,
+                      [this](int t) { calculateMarianiSilverRects(t); });
+    } else {
+      calculateMarianiSilverRects(0);
+    }
+
+    std::cout << "mariani silver: calculated " << computed_pixels
+              << " pixel, filled " << filled_pixels << " pixel" << std::endl;
   }
 
-  void drawMandelbrotSPLINE(int x, int y) {
-    const color::HSV<double> hsv = mandelbrot.mandelbrotSPLINE(lastData(x, y));
-    // function provided by child class
-    setPixelColor(x, y, hsv);
+  void calculateMarianiSilverRects(int worker) {
+    std::vector<double> re, im, result;
+    PixelRect rect;
+    while (marianiSilverQueue.pop(rect)) {
+      // a cancelled frame only empties the stack
+      if (!frameCancelled(worker)) {
+        calculateMarianiSilverRect(rect, re, im, result);
+      }
+      marianiSilverQueue.done();
+    }
   }
 
-  void userInteractions() {
+  // The border of the given rect is already calculated. Either fill, calculate
+  // or split the inside. Subrectangles are pushed to marianiSilverQueue so
+  // other threads can pick them up.
+  void calculateMarianiSilverRect(const PixelRect &rect,
+                                  std::vector<double> &re,
+                                  std::vector<double> &im,
+                                  std::vector<double> &result) {
+    // Rectangles smaller than that are calculated directly since splitting
+    // them would not save much.
+    constexpr int MIN_INNER_SIZE = 4;
+    const int inner_x = rect.x1 - rect.x0 - 1;
+    const int inner_y = rect.y1 - rect.y0 - 1;
+    if (inner_x <= 0 || inner_y <= 0) {
+      return;
+    }
+
+    if (hasUniformBorder(rect)) {
+      lastData.block(rect.x0 + 1, rect.y0 + 1, inner_x, inner_y)
+          .setConstant(lastData(rect.x0, rect.y0));
+      filled_pixels += inner_x * inner_y;
+      return;
+    }
+
+    if (inner_x <= MIN_INNER_SIZE || inner_y <= MIN_INNER_SIZE) {
+      for (int y = rect.y0 + 1; y < rect.y1; y++) {
+        calculateRowSegment(rect.x0 + 1, y, inner_x, re, im, result);
+      }
+      computed_pixels += inner_x * inner_y;
+      return;
+    }
+
+    // split the longer side, the new line is the common border of both halves
+    if (inner_x >= inner_y) {
+      const int x_split = (rect.x0 + rect.x1) / 2;
+      calculateColumnSegment(x_split, rect.y0 + 1, inner_y, re, im, result);
+      computed_pixels += inner_y;
+      marianiSilverQueue.push(PixelRect{rect.x0, rect.y0, x_split, rect.y1});
+      marianiSilverQueue.push(PixelRect{x_split, rect.y0, rect.x1, rect.y1});
+    } else {
+      const int y_split = (rect.y0 + rect.y1) / 2;
+      calculateRowSegment(rect.x0 + 1, y_split, inner_x, re, im, result);
+      computed_pixels += inner_x;
+      marianiSilverQueue.push(PixelRect{rect.x0, rect.y0, rect.x1, y_split});
+      marianiSilverQueue.push(PixelRect{rect.x0, y_split, rect.x1, rect.y1});
+    }
+  }
+
+  // With smoothing only the inside of the set has a uniform value, the
+  // outside varies continuously.
+  bool hasUniformBorder(const PixelRect &rect) const {
+    const double value = lastData(rect.x0, rect.y0);
+    for (int x = rect.x0; x <= rect.x1; x++) {
+      if (lastData(x, rect.y0) != value || lastData(x, rect.y1) != value) {
+        return false;
+      }
+    }
+    for (int y = rect.y0 + 1; y < rect.y1; y++) {
+      if (lastData(rect.x0, y) != value || lastData(rect.x1, y) != value) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Applies the zoom or the step back in the history the user requested.
+  void applyRequestedView() {
     if (zoom) {
       zoom = false;
 
@@ -371,9 +2579,21 @@ private:
       // set new zoom
       planar_transformation.setNewZoomWindowFromPicture(zoom_frame, imageSize(),
                                                         true);
+      recenterWorldOrigin();
+      iteration_factor = 1.;
+      need_update = true;
+    }
+    if (step_back) {
+      step_back = false;
+      planar_transformation.historyStepBack();
+      recenterWorldOrigin();
+      iteration_factor = 1.;
       need_update = true;
+    }
+  }
 
-    } else if (draw_zoom_window) {
+  void userInteractions() {
+    if (draw_zoom_window) {
       geometry::Rect zoom_frame(mouse_picture_corner1,
                                 current_mouse_picture_pos);
       // stay proportional
@@ -404,25 +2624,151 @@ private:
       }
     }
     const double span = max - min;
+    if (span <= 0.) {
+      // Happens deep inside the set: nothing to normalize.
+      normalize_min = 0.;
+      normalize_multiply = 1.;
+      return;
+    }
     const double multiply =
         static_cast<double>(mandelbrot.getMaxIterations()) / span;
     lastData = (lastData.array() - min) * multiply;
+    // for the anti-aliasing subsamples
+    normalize_min = min;
+    normalize_multiply = multiply;
   }
 
   conv::PlanarTransformation planar_transformation;
   Eigen::Vector2d mouse_picture_corner1;
   Eigen::Vector2d mouse_picture_corner2;
   Eigen::Vector2d current_mouse_picture_pos;
-  bool zoom = false;
+  // set by the callbacks, read by the threads of a frame, see
+  // frameCancelled()
+  std::atomic<bool> zoom{false};
+  std::atomic<bool> step_back{false};
+  std::atomic<bool> save_picture{false};
   bool draw_zoom_window = false;
-  bool need_update = true;
+  std::atomic<bool> need_update{true};
+  bool cancellable_frame = false;
+  bool frame_cancelled = false;
+  int cancelled_frames = 0;
+  std::chrono::steady_clock::time_point last_poll;
   Mandelbrot mandelbrot;
+  // The value of Mandelbrot::mandelbrot() per pixel as it is, the fraction
+  // of a smooth value included. The pixel pass used to truncate it to an int,
+  // which left bands in the smooth coloring; normalization, the anti aliasing
+  // subsamples and rescaling a resumed frame build on the untruncated value.
   Eigen::MatrixXd lastData;
   MultithreadManager multithreadManager;
+  ThreadPool thread_pool;
+  TileScheduler tile_scheduler;
+  int tile_size = DEFAULT_TILE_SIZE;
+  // the last frame was calculated by tile_scheduler
+  bool tiled_frame = false;
+  bool persistent_threads = true;
+  MarianiSilverQueue marianiSilverQueue;
+  RENDERING rendering = RENDERING::PIXEL_WISE;
+  PRECISION precision = PRECISION::AUTOMATIC;
+  // precision used for the current frame
+  PRECISION frame_precision = PRECISION::DOUBLE;
+  Perturbation perturbation;
+  // reference of the perturbation in world coordinates of
+  // planar_transformation
+  Eigen::Vector2d perturbation_reference = Eigen::Vector2d(0, 0);
+  // see recenterWorldOrigin()
+  Perturbation::Float world_origin_re = 0;
+  Perturbation::Float world_origin_im = 0;
+  Eigen::Vector2d world_origin = Eigen::Vector2d(0, 0);
+  DoubleDouble world_origin_dd_re;
+  DoubleDouble world_origin_dd_im;
+  FixedPoint world_origin_fp_re;
+  FixedPoint world_origin_fp_im;
+  // see recalculateImprecisePixel()
+  std::vector<char> imprecise_pixel;
+  double recalculated_fraction = 0.;
+  std::atomic<long> computed_pixels{0};
+  // see findMirroredRows()
+  bool symmetry = true;
+  std::vector<int> mirror_row;
+  int num_mirrored_rows = 0;
+  // see cullTiles()
+  bool interval_culling = true;
+  bool interval_culling_active = false;
+  // Pixel of the frame which are final before the main pass, from
+  // cullTiles() or the progressive previews. Only valid if known_pixel_active.
+  std::vector<char> known_pixel;
+  bool known_pixel_active = false;
+  // see setProgressive()
+  bool progressive = true;
+  int progressive_passes = 0;
+  double first_image_seconds = 0.;
+  double last_frame_seconds = 0.;
+  // see calculateImageStaged()
+  bool staged_iterations = true;
+  bool staged_active = false;
+  std::vector<int> stage_pixel;
+  std::vector<double> stage_re;
+  std::vector<double> stage_im;
+  std::vector<double> stage_zr;
+  std::vector<double> stage_zi;
+  std::vector<double> stage_saved_zr;
+  std::vector<double> stage_saved_zi;
+  std::vector<unsigned char> stage_unresolved;
+  std::vector<double> stage_result;
+  std::vector<long> stage_survivors;
+  // state of the last frame, see setResumableIterations()
+  bool resumable_iterations = false;
+  bool resume_active = false;
+  bool resuming = false;
+  Eigen::MatrixXd resume_data;
+  std::vector<double> resume_zr;
+  std::vector<double> resume_zi;
+  std::vector<double> resume_saved_zr;
+  std::vector<double> resume_saved_zi;
+  std::vector<unsigned char> resume_unresolved;
+  std::vector<double> resume_view;
+  unsigned int resume_iterations = 0;
+  unsigned int resume_from = 0;
+  std::atomic<long> num_resumed_pixel{0};
+  double iteration_factor = 1.;
+  bool adaptive_iterations = false;
+  double adaptive_sampling_ms = 0.;
+  // see setAntiAliasing()
+  int anti_aliasing = 0;
+  std::vector<int> anti_aliased_pixel;
+  std::vector<double> anti_aliasing_samples;
+  double normalize_min = 0.;
+  double normalize_multiply = 1.;
+  // see RENDERING::BUDDHABROT
+  Buddhabrot buddhabrot;
+  std::vector<func::RandomStream> buddhabrot_random;
+  std::vector<std::vector<unsigned int>> buddhabrot_thread_histogram;
+  std::vector<unsigned long> buddhabrot_histogram;
+  // progress of the threads in the current round
+  std::vector<long> buddhabrot_sampled;
+  std::vector<long> buddhabrot_round_escaped;
+  int buddhabrot_round = BUDDHABROT_ROUNDS;
+  long buddhabrot_orbits = 0;
+  long buddhabrot_escaped = 0;
+  double buddhabrot_seconds = 0.;
+  // see setJuliaPreview()
+  bool julia_preview = false;
+  std::thread julia_thread;
+  std::mutex julia_access;
+  std::condition_variable julia_wakeup;
+  bool julia_stop = false;
+  std::atomic<unsigned long> julia_generation{0};
+  Eigen::Vector2d julia_c = Eigen::Vector2d(0, 0);
+  formula::FORMULA julia_formula = formula::MANDELBROT;
+  std::vector<color::RGB<int>> julia_pixel;
+  bool julia_changed = false;
+  long num_tiles = 0;
+  std::atomic<long> culled_tiles_inside{0};
+  std::atomic<long> culled_tiles_escaped{0};
+  std::atomic<long> filled_pixels{0};
   tool::Timer timer;
   bool normalise_mandelbrot_iterations = true;
   COLORING coloring = COLORING::SPLINE;
-  DrawPixelWise drawPixelWise_f;
 
 protected:
   int resolution_x = DEFAULT_RESOLUTION_X;
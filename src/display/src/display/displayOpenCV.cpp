@@ -91,10 +91,35 @@ bool DisplayOpenCV::setPixelColor(int x, int y, const color::HSV<int> &hsvi) {
   return setPixelColor(x, y, rgbi);
 }
 
+void DisplayOpenCV::setPixelRow(int y, const unsigned char *rgb, int n) {
+  if (y >= image.rows) {
+    return;
+  }
+  cv::Vec3b *row = image.ptr<cv::Vec3b>(y);
+  for (int x = 0; x < std::min(n, image.cols); x++) {
+    // bgr!
+    row[x] = cv::Vec3b(rgb[3 * x + 2], rgb[3 * x + 1], rgb[3 * x]);
+  }
+}
+
 void DisplayOpenCV::updateImage() {
   if (isRunning()) {
-    cv::imshow(WINDOW_NAME, image);
-    cv::waitKey(1);
+    show(image);
+    waitKey(1);
+  }
+}
+
+void DisplayOpenCV::pollEvents() {
+  // open cv dispatches the mouse and trackbar callbacks in waitKey
+  if (isRunning()) {
+    waitKey(1);
+  }
+}
+
+void DisplayOpenCV::waitKey(int delay) {
+  const int key = cv::waitKey(delay);
+  if (key >= 0) {
+    pending_keys.push_back(key);
   }
 }
 
@@ -104,15 +129,58 @@ void DisplayOpenCV::drawRect(const geometry::Rect &rect) {
     cv::rectangle(copy, cv::Point(rect.corner1.x(), rect.corner1.y()),
                   cv::Point(rect.corner2.x(), rect.corner2.y()),
                   cv::Scalar(42, 42, 255), 2);
-    cv::imshow(WINDOW_NAME, copy);
-    cv::waitKey(20);
+    show(copy);
+    waitKey(20);
   }
 }
 
+void DisplayOpenCV::show(const cv::Mat &frame) {
+  if (julia_preview.empty() || julia_preview.cols > frame.cols ||
+      julia_preview.rows > frame.rows) {
+    cv::imshow(WINDOW_NAME, frame);
+    return;
+  }
+  cv::Mat copy = frame.clone();
+  const cv::Rect panel(frame.cols - julia_preview.cols, 0, julia_preview.cols,
+                       julia_preview.rows);
+  julia_preview.copyTo(copy(panel));
+  cv::rectangle(copy, panel, cv::Scalar(255, 255, 255), 1);
+  cv::imshow(WINDOW_NAME, copy);
+}
+
 void DisplayOpenCV::drawNoUpdate() {
+  std::vector<color::RGB<int>> pixel;
+  if (takeJuliaPreview(pixel)) {
+    if (pixel.empty()) {
+      julia_preview.release();
+    } else {
+      julia_preview.create(JULIA_PREVIEW_SIZE_Y, JULIA_PREVIEW_SIZE_X, CV_8UC3);
+      for (int y = 0; y < JULIA_PREVIEW_SIZE_Y; y++) {
+        for (int x = 0; x < JULIA_PREVIEW_SIZE_X; x++) {
+          // bgr!
+          const color::RGB<int> &rgbi = pixel[y * JULIA_PREVIEW_SIZE_X + x];
+          julia_preview.at<cv::Vec3b>(y, x) =
+              cv::Vec3b(static_cast<unsigned char>(rgbi.b),
+                        static_cast<unsigned char>(rgbi.g),
+                        static_cast<unsigned char>(rgbi.r));
+        }
+      }
+    }
+    if (isRunning()) {
+      show(image);
+    }
+  }
   // open cv does not support a KEY listener, so I put that key listening to the
-  // NOP operation
-  int key = cv::waitKey(20);
+  // NOP operation. The keys pressed during a frame are handled here as well.
+  waitKey(20);
+  while (!pending_keys.empty()) {
+    const int key = pending_keys.front();
+    pending_keys.pop_front();
+    dispatchKey(key);
+  }
+}
+
+void DisplayOpenCV::dispatchKey(int key) {
   // std::cout << key << std::endl;
   EVENT own_event = EVENT::OTHER;
   if (key == 233) { // ALT
@@ -124,7 +192,17 @@ void DisplayOpenCV::drawNoUpdate() {
   } else if (key == 3) { // alt gr
     own_event = EVENT::OTHER;
   } else if (key == 32) { // Space
-    own_event = EVENT::OTHER;
+    own_event = EVENT::MORE_DETAIL;
+  } else if (key == 106) { // j
+    own_event = EVENT::JULIA_PREVIEW;
+  } else if (key == 98) { // b
+    own_event = EVENT::BUDDHABROT_MODE;
+  } else if (key == 97) { // a
+    own_event = EVENT::ANTI_ALIASING;
+  } else if (key == 116) { // t
+    own_event = EVENT::PERSISTENT_THREADS;
+  } else if (key == 112) { // p
+    own_event = EVENT::PROGRESSIVE;
   }
   const Eigen::Vector2d pos(0, 0); // unknown
   this->userMouseInteractionCallback(own_event, pos);
@@ -181,6 +259,9 @@ void DisplayOpenCV::renderVideo() {
     return;
   }
   std::cout << "Begin rendering video. Abort with Q" << std::endl;
+  // only the finished frames are written
+  const bool progressive = getProgressive();
+  setProgressive(false);
   const double end_time = createPlayback();
   for (double t = 0; t < end_time; t = t + 0.001) {
     if (!setWindow2RecordedTime(t)) {
@@ -194,6 +275,9 @@ void DisplayOpenCV::renderVideo() {
     if (c == 'q' || c == 'Q')
       break;
   }
+  setProgressive(progressive);
+  // the keys pressed during the video were meant for it
+  pending_keys.clear();
 }
 
 void DisplayOpenCV::dbgSliderCallback(int i, void *me) {
@@ -2,6 +2,7 @@
 #define DISPLAY_OPEN_CV_H
 
 #include <base/structs.hpp>
+#include <deque>
 #include <display/display.h>
 #include <eigen3/Eigen/Core>
 #include <opencv2/opencv.hpp>
@@ -28,6 +29,7 @@ public:
   bool setPixelColor(int x, int y, const color::RGB<double> &rgb) override;
   bool setPixelColor(int x, int y, const color::HSV<int> &rgb) override;
   bool setPixelColor(int x, int y, const color::HSV<double> &rgb) override;
+  void setPixelRow(int y, const unsigned char *rgb, int n) override;
 
   int getWindowSizeX() const override;
 
@@ -41,6 +43,8 @@ public:
 
   void drawNoUpdate() override;
 
+  void pollEvents() override;
+
   void renderVideo() override;
 
   static void callUserMouseInteractionCallback(int event, int x, int y,
@@ -49,7 +53,20 @@ public:
   static void dbgSliderCallback(int, void *);
 
 private:
+  // Shows frame with the Julia preview in its top right corner.
+  void show(const cv::Mat &frame);
+
+  // cv::waitKey() that keeps the pressed key for drawNoUpdate(), also when it
+  // is called in the middle of a frame.
+  void waitKey(int delay);
+
+  void dispatchKey(int key);
+
   cv::Mat image;
+  // see Display::setJuliaPreview()
+  cv::Mat julia_preview;
+  // see waitKey()
+  std::deque<int> pending_keys;
 
   int dbg1 = static_cast<int>(0.2 * SLIDER_TICKS);
   int dbg2 = static_cast<int>(0.4 * SLIDER_TICKS);
@@ -0,0 +1,271 @@
+#include <base/planarTransformation.h>
+#include <base/structs.hpp>
+#include <display/display.h>
+#include <mandelbrot/mandelbrot.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Compares the float and the double kernel on the start view of the display,
+// the formulas on the start view and the double-double and the fixed point
+// kernel on deep views.
+// Usage: mandelbroetchen_benchmark [max_iterations] [repetitions]
+
+namespace {
+
+// The pixel coordinates of the start view, see disp::Display::Display().
+void homeViewCoordinates(std::vector<double> &re, std::vector<double> &im) {
+  const Eigen::Vector2d img_size(disp::DEFAULT_RESOLUTION_X,
+                                 disp::DEFAULT_RESOLUTION_Y);
+  const double window_proportion =
+      static_cast<double>(disp::DEFAULT_RESOLUTION_X) /
+      static_cast<double>(disp::DEFAULT_RESOLUTION_Y);
+  geometry::Rect initial_zoom(Eigen::Vector2d(0., 0.),
+                              Eigen::Vector2d(4. * window_proportion, -4.));
+  initial_zoom.setCenter(Eigen::Vector2d(0, 0));
+
+  conv::PlanarTransformation planar_transformation;
+  planar_transformation.initHomography(img_size, initial_zoom);
+
+  re.clear();
+  im.clear();
+  Eigen::Vector2d world;
+  for (int y = 0; y < disp::DEFAULT_RESOLUTION_Y; y++) {
+    for (int x = 0; x < disp::DEFAULT_RESOLUTION_X; x++) {
+      planar_transformation.transformToWorld(Eigen::Vector2d(x, y), world);
+      re.push_back(world.x());
+      im.push_back(world.y());
+    }
+  }
+}
+
+// Returns the fastest of the repetitions in ms.
+double benchmark(const Mandelbrot &mandelbrot,
+                 bool single_precision,
+                 const std::vector<double> &re,
+                 const std::vector<double> &im,
+                 int repetitions,
+                 std::vector<double> &result) {
+  const int n = static_cast<int>(re.size());
+  result.resize(n);
+  double best = -1;
+  for (int r = 0; r < repetitions; r++) {
+    const auto start = std::chrono::steady_clock::now();
+    // row by row like the display does
+    for (int i = 0; i < n; i += disp::DEFAULT_RESOLUTION_X) {
+      const int length = std::min(disp::DEFAULT_RESOLUTION_X, n - i);
+      if (single_precision) {
+        mandelbrot.mandelbrotSinglePrecision(
+            &re[i], &im[i], length, &result[i]);
+      } else {
+        mandelbrot.mandelbrot(&re[i], &im[i], length, &result[i]);
+      }
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    const double ms =
+        std::chrono::duration<double, std::milli>(stop - start).count();
+    if (best < 0 || ms < best) {
+      best = ms;
+    }
+  }
+  return best;
+}
+
+// A deep view of DEEP_SIZE_X x DEEP_SIZE_Y pixel with the given pixel distance
+// around c = i. The spirals around it show structure at every depth and it is
+// exactly representable in both kernels.
+constexpr int DEEP_SIZE_X = 320;
+constexpr int DEEP_SIZE_Y = 180;
+constexpr double DEEP_CENTER_RE = 0.;
+constexpr double DEEP_CENTER_IM = 1.;
+
+void deepViewOffsets(double pixel_distance,
+                     std::vector<double> &re,
+                     std::vector<double> &im) {
+  re.clear();
+  im.clear();
+  for (int y = 0; y < DEEP_SIZE_Y; y++) {
+    for (int x = 0; x < DEEP_SIZE_X; x++) {
+      re.push_back((x - DEEP_SIZE_X / 2) * pixel_distance);
+      im.push_back((DEEP_SIZE_Y / 2 - y) * pixel_distance);
+    }
+  }
+}
+
+// Returns the fastest of the repetitions in ms.
+template <typename Origin>
+double benchmarkDeep(const Mandelbrot &mandelbrot,
+                     const Origin &origin_re,
+                     const Origin &origin_im,
+                     const std::vector<double> &re,
+                     const std::vector<double> &im,
+                     int repetitions,
+                     std::vector<double> &result) {
+  const int n = static_cast<int>(re.size());
+  result.resize(n);
+  double best = -1;
+  for (int r = 0; r < repetitions; r++) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i += DEEP_SIZE_X) {
+      mandelbrot.mandelbrot(
+          origin_re, origin_im, &re[i], &im[i], DEEP_SIZE_X, &result[i]);
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    const double ms =
+        std::chrono::duration<double, std::milli>(stop - start).count();
+    if (best < 0 || ms < best) {
+      best = ms;
+    }
+  }
+  return best;
+}
+
+// Double-double has 106 bits of mantissa, the fixed point 124 fraction bits.
+// Down to a pixel distance of about 1e-32 both agree and the speed decides,
+// below double-double runs out of bits first.
+void compareDeepKernels(unsigned int max_iterations, int repetitions) {
+  const double pixel_distances[] = {1e-12, 1e-20, 1e-28, 1e-32, 1e-34};
+
+  Mandelbrot mandelbrot;
+  mandelbrot.setMaxIterations(max_iterations);
+  mandelbrot.setSmoothing(true);
+
+  const DoubleDouble dd_re(DEEP_CENTER_RE);
+  const DoubleDouble dd_im(DEEP_CENTER_IM);
+  const FixedPoint fp_re(DEEP_CENTER_RE);
+  const FixedPoint fp_im(DEEP_CENTER_IM);
+
+  std::cout << DEEP_SIZE_X << "x" << DEEP_SIZE_Y << " pixel deep view, "
+            << max_iterations << " iterations, best of " << repetitions
+            << std::endl;
+  std::vector<double> re, im;
+  std::vector<double> result_dd, result_fp;
+  for (const double pixel_distance : pixel_distances) {
+    deepViewOffsets(pixel_distance, re, im);
+    // same as the display, see Display::calculateImage()
+    mandelbrot.setPeriodicityEpsilon(std::min(1e-12, pixel_distance * 1e-3));
+    const double ms_dd = benchmarkDeep(
+        mandelbrot, dd_re, dd_im, re, im, repetitions, result_dd);
+    const double ms_fp = benchmarkDeep(
+        mandelbrot, fp_re, fp_im, re, im, repetitions, result_fp);
+
+    int different_pixel = 0;
+    for (size_t i = 0; i < result_dd.size(); i++) {
+      if (std::abs(result_dd[i] - result_fp[i]) >
+          static_cast<double>(max_iterations)) {
+        different_pixel++;
+      }
+    }
+    // A precision far too low shows as many equal pixel.
+    std::sort(result_dd.begin(), result_dd.end());
+    std::sort(result_fp.begin(), result_fp.end());
+    const long distinct_dd =
+        std::unique(result_dd.begin(), result_dd.end()) - result_dd.begin();
+    const long distinct_fp =
+        std::unique(result_fp.begin(), result_fp.end()) - result_fp.begin();
+
+    std::cout << "pixel distance " << pixel_distance << ": double-double "
+              << ms_dd << "ms (" << distinct_dd
+              << " distinct values), fixed point " << ms_fp << "ms ("
+              << distinct_fp << " distinct values), speedup " << ms_dd / ms_fp
+              << ", " << different_pixel << " pixel differ" << std::endl;
+  }
+}
+
+// The formulas differ in the number of iterations per pixel, so compare the
+// time per iteration. Without smoothing the result is the number of
+// iterations, as long as the periodicity check does not stop any pixel.
+void compareFormulas(const std::vector<double> &re,
+                     const std::vector<double> &im,
+                     unsigned int max_iterations,
+                     int repetitions) {
+  const formula::FORMULA formulas[] = {formula::MANDELBROT,
+                                       formula::MULTIBROT_3,
+                                       formula::MULTIBROT_4,
+                                       formula::BURNING_SHIP,
+                                       formula::TRICORN};
+  const char *names[] = {
+      "mandelbrot", "multibrot 3", "multibrot 4", "burning ship", "tricorn"};
+
+  Mandelbrot mandelbrot;
+  mandelbrot.setMaxIterations(max_iterations);
+  mandelbrot.setPeriodicityCheck(false);
+  mandelbrot.setComponentLookup(false);
+  std::vector<double> result;
+  for (int f = 0; f < 5; f++) {
+    mandelbrot.setFormula(formulas[f]);
+    const double ms =
+        benchmark(mandelbrot, false, re, im, repetitions, result);
+    double iterations = 0;
+    for (const double r : result) {
+      iterations += r;
+    }
+    std::cout << names[f] << ": " << ms << "ms, "
+              << ms * 1e6 / iterations << "ns per iteration" << std::endl;
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  // the display starts with 215 iterations
+  const unsigned int max_iterations = argc > 1 ? std::atoi(argv[1]) : 215;
+  const int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+  std::vector<double> re, im;
+  homeViewCoordinates(re, im);
+  const double mega_pixel = re.size() * 1e-6;
+  std::cout << disp::DEFAULT_RESOLUTION_X << "x" << disp::DEFAULT_RESOLUTION_Y
+            << " pixel, " << max_iterations << " iterations, best of "
+            << repetitions << std::endl;
+
+  Mandelbrot mandelbrot;
+  mandelbrot.setMaxIterations(max_iterations);
+  mandelbrot.setSmoothing(true);
+
+  const Mandelbrot::VECTORIZATION vectorizations[] = {
+      Mandelbrot::SCALAR, Mandelbrot::AVX2, Mandelbrot::AVX512};
+  std::vector<double> result_double, result_float;
+  for (const auto v : vectorizations) {
+    if (!mandelbrot.setVectorization(v)) {
+      continue;
+    }
+    const double ms_double =
+        benchmark(mandelbrot, false, re, im, repetitions, result_double);
+    const double ms_float =
+        benchmark(mandelbrot, true, re, im, repetitions, result_float);
+
+    // The smooth result is iterations * max_iterations. Single pixel at the
+    // border of the set flip between inside and outside, so the maximum says
+    // nothing, count the pixel differing by more than one iteration instead.
+    double mean_difference = 0;
+    int different_pixel = 0;
+    for (size_t i = 0; i < result_double.size(); i++) {
+      const double difference = std::abs(result_double[i] - result_float[i]) /
+                                static_cast<double>(max_iterations);
+      mean_difference += difference;
+      if (difference > 1.) {
+        different_pixel++;
+      }
+    }
+    mean_difference /= result_double.size();
+
+    std::cout << Mandelbrot::vectorizationName(v) << ": double " << ms_double
+              << "ms (" << mega_pixel * 1e3 / ms_double << " MPixel/s), float "
+              << ms_float << "ms (" << mega_pixel * 1e3 / ms_float
+              << " MPixel/s), speedup " << ms_double / ms_float
+              << ", mean difference " << mean_difference << " iterations, "
+              << different_pixel << " pixel differ" << std::endl;
+  }
+
+  compareFormulas(re, im, max_iterations, repetitions);
+
+  // The deep views need far more iterations than the start view.
+  compareDeepKernels(std::max(max_iterations * 10, 2000u), repetitions);
+
+  return 0;
+}
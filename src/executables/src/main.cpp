@@ -9,7 +9,7 @@ int main() {
   disp::DisplayOpenCV D;
   // D.setDrawFunction(disp::Display::COLORING::SPLINE);
   D.setDrawFunction(disp::Display::COLORING::COS);
-  D.setNumThreads(4);
+  D.autoConfigure();
   D.startUpdateLoop();
 
   std::getchar();
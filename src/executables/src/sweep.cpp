@@ -0,0 +1,61 @@
+#include <base/cpuTopology.h>
+#include <mandelbrot/mandelbrot.h>
+#include <mandelbrot/sweep.h>
+
+#include <cstdlib>
+#include <iostream>
+
+// Sweeps a size x size grid over [-2, 0.5] x [-1.25, 1.25] without keeping
+// the pixel and prints the fraction of interior pixel, the estimated area of
+// the set and the histogram of the escape times.
+// Usage: mandelbroetchen_sweep [size] [max_iterations] [threads]
+// The default is one thread per physical core.
+
+int main(int argc, char **argv) {
+  const long long size = argc > 1 ? std::atoll(argv[1]) : 100000;
+  const unsigned int max_iterations = argc > 2 ? std::atoi(argv[2]) : 256;
+  const int num_threads =
+      argc > 3 ? std::atoi(argv[3])
+               : static_cast<int>(hw::detectCpuTopology().cores.size());
+
+  constexpr double RE0 = -2.;
+  constexpr double RE1 = 0.5;
+  constexpr double IM0 = -1.25;
+  constexpr double IM1 = 1.25;
+
+  Mandelbrot mandelbrot;
+  mandelbrot.setMaxIterations(max_iterations);
+  std::cout << size << "x" << size << " pixel, " << max_iterations
+            << " iterations, " << num_threads << " threads, "
+            << Mandelbrot::vectorizationName(mandelbrot.getVectorization())
+            << std::endl;
+
+  const Sweep sweep(RE0, IM0, RE1, IM1, size, size);
+  const Sweep::Statistics statistics = sweep.run(mandelbrot, num_threads);
+
+  const double interior_fraction =
+      static_cast<double>(statistics.interior) / statistics.pixel;
+  std::cout << "interior: " << statistics.interior << " pixel ("
+            << interior_fraction * 100. << "%), area "
+            << interior_fraction * (RE1 - RE0) * (IM1 - IM0) << std::endl;
+  std::cout << "iterations: " << statistics.iterations << " ("
+            << static_cast<double>(statistics.iterations) / statistics.pixel
+            << " per pixel)" << std::endl;
+  std::cout << statistics.seconds << " s, "
+            << statistics.pixel / statistics.seconds * 1e-6
+            << " mega pixel/s" << std::endl;
+
+  // escape times in ranges doubling in length: 0, 1, 2-3, 4-7, ...
+  std::cout << "escaped at iteration:" << std::endl;
+  for (size_t from = 0; from < statistics.histogram.size();
+       from = from == 0 ? 1 : 2 * from) {
+    const size_t to =
+        std::min(from == 0 ? 1 : 2 * from, statistics.histogram.size());
+    long long count = 0;
+    for (size_t i = from; i < to; i++) {
+      count += statistics.histogram[i];
+    }
+    std::cout << "  " << from << "-" << to - 1 << ": " << count << std::endl;
+  }
+  return 0;
+}
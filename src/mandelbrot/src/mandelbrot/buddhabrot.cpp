@@ -0,0 +1,82 @@
+#include <mandelbrot/buddhabrot.h>
+
+void Buddhabrot::setView(double re0_,
+                         double im0_,
+                         double re1,
+                         double im1,
+                         int width_,
+                         int height_) {
+  re0 = re0_;
+  im0 = im0_;
+  width = width_;
+  height = height_;
+  scale_re = width / (re1 - re0);
+  scale_im = height / (im1 - im0);
+}
+
+long Buddhabrot::sample(func::RandomStream &random,
+                        long n,
+                        std::vector<unsigned int> &histogram) const {
+  switch (iteration_formula) {
+  case formula::MULTIBROT_3:
+    return sampleFormula<formula::Multibrot<3>>(random, n, histogram);
+  case formula::MULTIBROT_4:
+    return sampleFormula<formula::Multibrot<4>>(random, n, histogram);
+  case formula::BURNING_SHIP:
+    return sampleFormula<formula::BurningShip>(random, n, histogram);
+  case formula::TRICORN:
+    return sampleFormula<formula::Tricorn>(random, n, histogram);
+  case formula::MANDELBROT:
+    break;
+  }
+  return sampleFormula<formula::Quadratic>(random, n, histogram);
+}
+
+template <class Formula>
+long Buddhabrot::sampleFormula(func::RandomStream &random,
+                               long n,
+                               std::vector<unsigned int> &histogram) const {
+  // The orbit is only counted if it escapes, so it is kept until then.
+  std::vector<double> orbit_re(max_iterations);
+  std::vector<double> orbit_im(max_iterations);
+  long escaped = 0;
+  for (long s = 0; s < n; s++) {
+    const double cr = random.uniform(-2., 2.);
+    const double ci = random.uniform(-2., 2.);
+    if (iteration_formula == formula::MANDELBROT) {
+      // the M1/M2 bulbs never escape, see Mandelbrot::isInsideM1M2
+      const double c2 = cr * cr + ci * ci;
+      if (256.0 * c2 * c2 - 96.0 * c2 + 32.0 * cr - 3.0 < 0.0 ||
+          16.0 * (c2 + 2.0 * cr + 1.0) - 1.0 < 0.0) {
+        continue;
+      }
+    }
+
+    double zr = 0.;
+    double zi = 0.;
+    unsigned int length = 0;
+    bool escapes = false;
+    for (; length < max_iterations; length++) {
+      Formula::template step<formula::ScalarOps<double>>(zr, zi, cr, ci);
+      if (zr * zr + zi * zi > 4.) {
+        escapes = true;
+        break;
+      }
+      orbit_re[length] = zr;
+      orbit_im[length] = zi;
+    }
+    if (!escapes) {
+      continue;
+    }
+
+    escaped++;
+    for (unsigned int i = 0; i < length; i++) {
+      const double x = (orbit_re[i] - re0) * scale_re;
+      const double y = (orbit_im[i] - im0) * scale_im;
+      if (x >= 0. && x < width && y >= 0. && y < height) {
+        histogram[static_cast<int>(y) * width + static_cast<int>(x)]++;
+      }
+    }
+  }
+  return escaped;
+}
@@ -0,0 +1,57 @@
+#ifndef BUDDHABROT_H
+#define BUDDHABROT_H
+
+#include <base/randomGenerators.h>
+#include <mandelbrot/formula.hpp>
+#include <vector>
+
+// Orbit density of the escaping points, the "Buddhabrot": random c are
+// iterated and every Z of the orbits which escape is counted in the bin of a
+// histogram it falls into. sample() is thread safe as long as every thread
+// passes its own random stream and histogram. Merge the histograms of the
+// threads afterwards.
+class Buddhabrot {
+public:
+  // The bins cover the rectangle from the corner (re0, im0) at bin (0, 0) to
+  // the corner (re1, im1), width x height bins stored row by row. The corners
+  // may be in any order, e.g. the world coordinates of the image corners.
+  void setView(double re0,
+               double im0,
+               double re1,
+               double im1,
+               int width,
+               int height);
+
+  int getWidth() const { return width; }
+
+  int getHeight() const { return height; }
+
+  void setMaxIterations(unsigned int maxIt) { max_iterations = maxIt; }
+
+  unsigned int getMaxIterations() const { return max_iterations; }
+
+  void setFormula(formula::FORMULA f) { iteration_formula = f; }
+
+  // Iterates n random c of [-2, 2] x [-2, 2] and counts the orbits which
+  // escape within max_iterations into histogram, which must have width x
+  // height bins. Returns the number of escaping orbits.
+  long sample(func::RandomStream &random,
+              long n,
+              std::vector<unsigned int> &histogram) const;
+
+private:
+  template <class Formula>
+  long sampleFormula(func::RandomStream &random,
+                     long n,
+                     std::vector<unsigned int> &histogram) const;
+
+  double re0 = -2., im0 = 2.;
+  // bins per unit
+  double scale_re = 1., scale_im = -1.;
+  int width = 1;
+  int height = 1;
+  unsigned int max_iterations = 100;
+  formula::FORMULA iteration_formula = formula::MANDELBROT;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef DOUBLE_DOUBLE_HPP
+#define DOUBLE_DOUBLE_HPP
+
+// Unevaluated sum hi + lo of two doubles with |lo| <= ulp(hi) / 2, which gives
+// about 106 bits of mantissa using only double operations. See
+// Dekker 1971 and Hida, Li, Bailey "Library for Double-Double and Quad-Double
+// Arithmetic" 2007.
+// The error free transformations only hold if the compiler does not contract
+// a * b + c into a fused multiply add, so compile with -ffp-contract=off!
+
+struct DoubleDouble {
+  double hi = 0.;
+  double lo = 0.;
+
+  DoubleDouble() {}
+  DoubleDouble(double h) : hi(h) {}
+  DoubleDouble(double h, double l) : hi(h), lo(l) {}
+
+  double toDouble() const { return hi + lo; }
+};
+
+namespace dd {
+
+// s + e = a + b exactly
+inline DoubleDouble twoSum(double a, double b) {
+  const double s = a + b;
+  const double bb = s - a;
+  const double e = (a - (s - bb)) + (b - bb);
+  return DoubleDouble(s, e);
+}
+
+// s + e = a + b exactly if |a| >= |b|
+inline DoubleDouble quickTwoSum(double a, double b) {
+  const double s = a + b;
+  const double e = b - (s - a);
+  return DoubleDouble(s, e);
+}
+
+// a = hi + lo with both halves having 26 bits
+inline void split(double a, double &hi, double &lo) {
+  const double splitter = 134217729.0; // 2^27 + 1
+  const double t = splitter * a;
+  hi = t - (t - a);
+  lo = a - hi;
+}
+
+// p + e = a * b exactly
+inline DoubleDouble twoProd(double a, double b) {
+  const double p = a * b;
+  double a_hi, a_lo, b_hi, b_lo;
+  split(a, a_hi, a_lo);
+  split(b, b_hi, b_lo);
+  const double e =
+      ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+  return DoubleDouble(p, e);
+}
+
+} // namespace dd
+
+inline DoubleDouble operator+(const DoubleDouble &a, const DoubleDouble &b) {
+  DoubleDouble s = dd::twoSum(a.hi, b.hi);
+  const DoubleDouble t = dd::twoSum(a.lo, b.lo);
+  s.lo += t.hi;
+  s = dd::quickTwoSum(s.hi, s.lo);
+  s.lo += t.lo;
+  return dd::quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator+(const DoubleDouble &a, double b) {
+  DoubleDouble s = dd::twoSum(a.hi, b);
+  s.lo += a.lo;
+  return dd::quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble &a) {
+  return DoubleDouble(-a.hi, -a.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble &a, const DoubleDouble &b) {
+  return a + (-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble &a, const DoubleDouble &b) {
+  DoubleDouble p = dd::twoProd(a.hi, b.hi);
+  p.lo += a.hi * b.lo + a.lo * b.hi;
+  return dd::quickTwoSum(p.hi, p.lo);
+}
+
+inline DoubleDouble operator*(const DoubleDouble &a, double b) {
+  DoubleDouble p = dd::twoProd(a.hi, b);
+  p.lo += a.lo * b;
+  return dd::quickTwoSum(p.hi, p.lo);
+}
+
+inline bool operator<(const DoubleDouble &a, const DoubleDouble &b) {
+  return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+inline bool operator>(const DoubleDouble &a, const DoubleDouble &b) {
+  return b < a;
+}
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef ESCAPE_TIME_KERNEL_HPP
+#define ESCAPE_TIME_KERNEL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <mandelbrot/formula.hpp>
+#include <mandelbrot/kernel.h>
+
+// Vectorized version of Mandelbrot::mandelbrot_classic and
+// Mandelbrot::mandelbrot_smooth. The Pack class wraps the intrinsics of one
+// instruction set, see kernelAVX2.cpp and kernelAVX512.cpp. Only include this
+// into translation units compiled with the matching instruction set flags!
+// The operations are done in the same order as in the scalar version, so the
+// results are bit identical. Pack::scalar is either double or float, the
+// coordinates are always passed as double and rounded by Pack::load. The Pack
+// classes have the interface of formula::ScalarOps, so they iterate any
+// formula.
+
+namespace kernel {
+namespace {
+
+// Returns the number of lanes stopped by the periodicity check. state_zr,
+// state_zi, state_saved_zr, state_saved_zi and unresolved are the lanes' part
+// of the optional state of params, see EscapeTimeParams.
+template <class Pack, class Formula>
+int escapeTimePack(const EscapeTimeParams &params,
+                    const double *re,
+                    const double *im,
+                    double *state_zr,
+                    double *state_zi,
+                    double *state_saved_zr,
+                    double *state_saved_zi,
+                    unsigned char *unresolved,
+                    double *result) {
+  typedef typename Pack::scalar scalar;
+  typedef typename Pack::real real;
+  typedef typename Pack::mask mask;
+  constexpr int W = Pack::width;
+
+  const real cr = params.julia ? Pack::set1(params.julia_re) : Pack::load(re);
+  const real ci = params.julia ? Pack::set1(params.julia_im) : Pack::load(im);
+  const real zero = Pack::set1(0.);
+  const real one = Pack::set1(1.);
+
+  // M1/M2 bulb test, see Mandelbrot::isInsideM1M2
+  mask inside = Pack::allFalse();
+  if (params.formula == formula::MANDELBROT && !params.julia) {
+    const real c2 = Pack::add(Pack::mul(cr, cr), Pack::mul(ci, ci));
+    const real m1 = Pack::sub(
+        Pack::add(Pack::sub(Pack::mul(Pack::mul(Pack::set1(256.), c2), c2),
+                            Pack::mul(Pack::set1(96.), c2)),
+                  Pack::mul(Pack::set1(32.), cr)),
+        Pack::set1(3.));
+    const real m2 = Pack::sub(
+        Pack::mul(
+            Pack::set1(16.),
+            Pack::add(Pack::add(c2, Pack::mul(Pack::set1(2.), cr)), one)),
+        one);
+    inside = Pack::orMask(Pack::less(m1, zero), Pack::less(m2, zero));
+  }
+
+  const real G = Pack::set1(params.smoothing ? 256.0 * 256.0 : 4.);
+
+  const real epsilon = Pack::set1(params.periodicity_epsilon);
+
+  mask active = Pack::andNotMask(Pack::allTrue(), inside);
+  mask periodic = Pack::allFalse();
+  const bool has_state = state_zr != nullptr;
+  // the Julia set starts at the point itself
+  const real z0r = params.julia ? Pack::load(re) : zero;
+  const real z0i = params.julia ? Pack::load(im) : zero;
+  real zr = has_state ? Pack::load(state_zr) : z0r;
+  real zi = has_state ? Pack::load(state_zi) : z0i;
+  real zr_saved = has_state ? Pack::load(state_saved_zr) : zr;
+  real zi_saved = has_state ? Pack::load(state_saved_zi) : zi;
+  // same saved Z and save points as without resuming, see Mandelbrot::iterate
+  unsigned int save_at = 1;
+  while (save_at <= params.start_iteration) {
+    save_at *= 2;
+  }
+  real magnitude = zero;
+  real iterations = Pack::set1(params.start_iteration);
+
+  for (unsigned int i = params.start_iteration;
+       i < params.max_iterations && Pack::any(active);
+       i++) {
+    real zr_new = zr;
+    real zi_new = zi;
+    Formula::template step<Pack>(zr_new, zi_new, cr, ci);
+    // escaped lanes keep their last Z for the smoothing
+    zr = Pack::select(active, zr_new, zr);
+    zi = Pack::select(active, zi_new, zi);
+    magnitude = Pack::add(Pack::mul(zr, zr), Pack::mul(zi, zi));
+    active = Pack::andNotMask(active, Pack::greater(magnitude, G));
+    iterations = Pack::addIf(active, iterations, one);
+
+    if (params.periodicity_check) {
+      // Brent's cycle detection, see Mandelbrot::iterate
+      const mask close_re =
+          Pack::less(Pack::abs(Pack::sub(zr, zr_saved)), epsilon);
+      const mask close_im =
+          Pack::less(Pack::abs(Pack::sub(zi, zi_saved)), epsilon);
+      const mask cycle =
+          Pack::andMask(active, Pack::andMask(close_re, close_im));
+      periodic = Pack::orMask(periodic, cycle);
+      active = Pack::andNotMask(active, cycle);
+      if (i == save_at) {
+        zr_saved = zr;
+        zi_saved = zi;
+        save_at *= 2;
+      }
+    }
+  }
+
+  alignas(64) scalar lane_iterations[W];
+  alignas(64) scalar lane_magnitude[W];
+  Pack::store(lane_iterations, iterations);
+  Pack::store(lane_magnitude, magnitude);
+  const int inside_bits = Pack::bits(inside);
+  const int active_bits = Pack::bits(active);
+  const int periodic_bits = Pack::bits(periodic);
+  const double max_iterations = params.max_iterations;
+
+  if (has_state) {
+    alignas(64) scalar lane_zr[W];
+    alignas(64) scalar lane_zi[W];
+    alignas(64) scalar lane_saved_zr[W];
+    alignas(64) scalar lane_saved_zi[W];
+    Pack::store(lane_zr, zr);
+    Pack::store(lane_zi, zi);
+    Pack::store(lane_saved_zr, zr_saved);
+    Pack::store(lane_saved_zi, zi_saved);
+    for (int l = 0; l < W; l++) {
+      state_zr[l] = lane_zr[l];
+      state_zi[l] = lane_zi[l];
+      state_saved_zr[l] = lane_saved_zr[l];
+      state_saved_zi[l] = lane_saved_zi[l];
+      unresolved[l] = (active_bits & (1 << l)) ? 1 : 0;
+    }
+  }
+
+  int shortcuts = 0;
+  for (int l = 0; l < W; l++) {
+    if (inside_bits & (1 << l)) {
+      result[l] = 0;
+    } else if (periodic_bits & (1 << l)) {
+      shortcuts++;
+      result[l] = params.smoothing ? 0 : max_iterations;
+    } else if (!params.smoothing) {
+      result[l] = lane_iterations[l];
+    } else if (active_bits & (1 << l)) {
+      // did not escape
+      result[l] = 0;
+    } else {
+      result[l] = formula::smooth(lane_iterations[l],
+                                  lane_magnitude[l],
+                                  max_iterations,
+                                  Formula::degree);
+    }
+  }
+  return shortcuts;
+}
+
+template <class Pack, class Formula>
+int escapeTimeFormula(const EscapeTimeParams &params,
+               const double *re,
+               const double *im,
+               int n,
+               double *result) {
+  constexpr int W = Pack::width;
+  const bool has_state = params.zr != nullptr;
+  int shortcuts = 0;
+  int i = 0;
+  for (; i + W <= n; i += W) {
+    shortcuts += escapeTimePack<Pack, Formula>(params,
+                                      re + i,
+                                      im + i,
+                                      has_state ? params.zr + i : nullptr,
+                                      has_state ? params.zi + i : nullptr,
+                                      has_state ? params.saved_zr + i : nullptr,
+                                      has_state ? params.saved_zi + i : nullptr,
+                                      has_state ? params.unresolved + i
+                                                : nullptr,
+                                      result + i);
+  }
+  if (i < n) {
+    // Fill the unused lanes with c = 4 which escapes in every formula within
+    // a few iterations, the larger bailout of the smoothing included. c = 0
+    // would be inside M1 but iterate up to the limit in the other formulas.
+    // As start value of a Julia set 4 escapes as well.
+    double re_tail[W];
+    double im_tail[W] = {0.};
+    std::fill(re_tail, re_tail + W, 4.);
+    double zr_tail[W] = {0.};
+    double zi_tail[W] = {0.};
+    double saved_zr_tail[W] = {0.};
+    double saved_zi_tail[W] = {0.};
+    unsigned char unresolved_tail[W];
+    double result_tail[W];
+    for (int l = 0; i + l < n; l++) {
+      re_tail[l] = re[i + l];
+      im_tail[l] = im[i + l];
+      if (has_state) {
+        zr_tail[l] = params.zr[i + l];
+        zi_tail[l] = params.zi[i + l];
+        saved_zr_tail[l] = params.saved_zr[i + l];
+        saved_zi_tail[l] = params.saved_zi[i + l];
+      }
+    }
+    shortcuts += escapeTimePack<Pack, Formula>(params,
+                                      re_tail,
+                                      im_tail,
+                                      has_state ? zr_tail : nullptr,
+                                      has_state ? zi_tail : nullptr,
+                                      has_state ? saved_zr_tail : nullptr,
+                                      has_state ? saved_zi_tail : nullptr,
+                                      unresolved_tail,
+                                      result_tail);
+    for (int l = 0; i + l < n; l++) {
+      result[i + l] = result_tail[l];
+      if (has_state) {
+        params.zr[i + l] = zr_tail[l];
+        params.zi[i + l] = zi_tail[l];
+        params.saved_zr[i + l] = saved_zr_tail[l];
+        params.saved_zi[i + l] = saved_zi_tail[l];
+        params.unresolved[i + l] = unresolved_tail[l];
+      }
+    }
+  }
+  return shortcuts;
+}
+
+template <class Pack>
+int escapeTime(const EscapeTimeParams &params,
+               const double *re,
+               const double *im,
+               int n,
+               double *result) {
+  switch (params.formula) {
+  case formula::MULTIBROT_3:
+    return escapeTimeFormula<Pack, formula::Multibrot<3>>(
+        params, re, im, n, result);
+  case formula::MULTIBROT_4:
+    return escapeTimeFormula<Pack, formula::Multibrot<4>>(
+        params, re, im, n, result);
+  case formula::BURNING_SHIP:
+    return escapeTimeFormula<Pack, formula::BurningShip>(
+        params, re, im, n, result);
+  case formula::TRICORN:
+    return escapeTimeFormula<Pack, formula::Tricorn>(
+        params, re, im, n, result);
+  case formula::MANDELBROT:
+    break;
+  }
+  return escapeTimeFormula<Pack, formula::Quadratic>(params, re, im, n, result);
+}
+
+}  // namespace
+}  // namespace kernel
+
+#endif
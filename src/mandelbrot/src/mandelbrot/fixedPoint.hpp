@@ -0,0 +1,104 @@
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <cmath>
+#include <cstdint>
+
+// Signed 4.124 fixed point number: the sign, 3 integer bits and 124 fraction
+// bits in a __int128. That covers [-8, 8) with a resolution of 2^-124 (6e-38).
+// All operations are integer operations, so the results are bit identical on
+// every machine regardless of compiler flags and floating point units.
+// Overflow is not checked, see Mandelbrot::mandelbrot(FixedPoint, FixedPoint)
+// how to keep the iteration in range.
+
+struct FixedPoint {
+  static constexpr int FRACTION_BITS = 124;
+
+  __int128 value = 0;
+
+  FixedPoint() {}
+
+  // Exact for every double in range with no bits below 2^-124, otherwise
+  // truncated towards zero.
+  explicit FixedPoint(double d) {
+    if (d == 0.) {
+      return;
+    }
+    int exponent;
+    // d = mantissa * 2^(exponent - 53) with a 53 bit integer mantissa
+    const double m = std::frexp(std::abs(d), &exponent);
+    const unsigned __int128 mantissa =
+        static_cast<uint64_t>(std::ldexp(m, 53));
+    const int shift = exponent - 53 + FRACTION_BITS;
+    unsigned __int128 magnitude = 0;
+    if (shift >= 0) {
+      magnitude = mantissa << shift;
+    } else if (shift > -64) {
+      magnitude = mantissa >> -shift;
+    }
+    value = d < 0 ? -static_cast<__int128>(magnitude)
+                  : static_cast<__int128>(magnitude);
+  }
+
+  double toDouble() const {
+    return std::ldexp(static_cast<double>(value), -FRACTION_BITS);
+  }
+};
+
+inline FixedPoint operator+(const FixedPoint &a, const FixedPoint &b) {
+  FixedPoint s;
+  s.value = a.value + b.value;
+  return s;
+}
+
+inline FixedPoint operator-(const FixedPoint &a, const FixedPoint &b) {
+  FixedPoint s;
+  s.value = a.value - b.value;
+  return s;
+}
+
+// Truncates the magnitude of the 248 bit product to 124 fraction bits.
+inline FixedPoint operator*(const FixedPoint &a, const FixedPoint &b) {
+  typedef unsigned __int128 uint128;
+  const bool negative = (a.value < 0) != (b.value < 0);
+  const uint128 x = a.value < 0 ? -static_cast<uint128>(a.value) : a.value;
+  const uint128 y = b.value < 0 ? -static_cast<uint128>(b.value) : b.value;
+
+  const uint64_t x1 = static_cast<uint64_t>(x >> 64);
+  const uint64_t x0 = static_cast<uint64_t>(x);
+  const uint64_t y1 = static_cast<uint64_t>(y >> 64);
+  const uint64_t y0 = static_cast<uint64_t>(y);
+  const uint128 p00 = static_cast<uint128>(x0) * y0;
+  const uint128 p01 = static_cast<uint128>(x0) * y1;
+  const uint128 p10 = static_cast<uint128>(x1) * y0;
+  const uint128 p11 = static_cast<uint128>(x1) * y1;
+
+  // x * y = high * 2^128 + low
+  const uint128 middle = (p00 >> 64) + static_cast<uint64_t>(p01) +
+                         static_cast<uint64_t>(p10);
+  const uint128 high = p11 + (p01 >> 64) + (p10 >> 64) + (middle >> 64);
+  const uint128 low = (middle << 64) | static_cast<uint64_t>(p00);
+  const uint128 product = (high << (128 - FixedPoint::FRACTION_BITS)) |
+                          (low >> FixedPoint::FRACTION_BITS);
+
+  FixedPoint p;
+  p.value = negative ? -static_cast<__int128>(product)
+                     : static_cast<__int128>(product);
+  return p;
+}
+
+inline bool operator<(const FixedPoint &a, const FixedPoint &b) {
+  return a.value < b.value;
+}
+
+inline bool operator>(const FixedPoint &a, const FixedPoint &b) {
+  return b < a;
+}
+
+inline FixedPoint abs(const FixedPoint &a) {
+  FixedPoint r;
+  r.value = a.value < 0 ? -a.value : a.value;
+  return r;
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef FORMULA_HPP
+#define FORMULA_HPP
+
+#include <cmath>
+
+// The iteration Z -> f(Z) + c of the escape time fractals. Every formula is a
+// class with a static step() templated on the arithmetic: ScalarOps for the
+// scalar kernel and the Pack classes of the SIMD kernels (see
+// escapeTimeKernel.hpp) share the same code, so both do the operations in the
+// same order and give bit identical results. The formula is chosen once per
+// batch, the inner loops contain no branch on it.
+
+namespace formula {
+
+// MANDELBROT: z^2 + c, the only one with the M1/M2 test, the component
+// lookup, the interval culling and the deep zoom tiers.
+// MULTIBROT_3, MULTIBROT_4: z^3 + c and z^4 + c.
+// BURNING_SHIP: (|x| + i|y|)^2 + c, not symmetric to the real axis.
+// TRICORN: conj(z)^2 + c.
+enum FORMULA { MANDELBROT, MULTIBROT_3, MULTIBROT_4, BURNING_SHIP, TRICORN };
+
+// Same interface as the Pack classes for a single float or double.
+template <typename T> struct ScalarOps {
+  typedef T real;
+  static real set1(double v) { return static_cast<T>(v); }
+  static real add(real a, real b) { return a + b; }
+  static real sub(real a, real b) { return a - b; }
+  static real mul(real a, real b) { return a * b; }
+  static real abs(real a) { return std::abs(a); }
+};
+
+struct Quadratic {
+  static constexpr int degree = 2;
+  static constexpr bool conjugate_symmetric = true;
+
+  template <class Ops>
+  static void step(typename Ops::real &zr,
+                   typename Ops::real &zi,
+                   typename Ops::real cr,
+                   typename Ops::real ci) {
+    const typename Ops::real zr_new =
+        Ops::add(Ops::sub(Ops::mul(zr, zr), Ops::mul(zi, zi)), cr);
+    zi = Ops::add(Ops::mul(Ops::mul(Ops::set1(2.), zr), zi), ci);
+    zr = zr_new;
+  }
+};
+
+template <int N> struct Multibrot {
+  static constexpr int degree = N;
+  static constexpr bool conjugate_symmetric = true;
+
+  template <class Ops>
+  static void step(typename Ops::real &zr,
+                   typename Ops::real &zi,
+                   typename Ops::real cr,
+                   typename Ops::real ci) {
+    typename Ops::real wr = zr;
+    typename Ops::real wi = zi;
+    // N is known at compile time, the loop is unrolled
+    for (int k = 1; k < N; k++) {
+      const typename Ops::real wr_new =
+          Ops::sub(Ops::mul(wr, zr), Ops::mul(wi, zi));
+      wi = Ops::add(Ops::mul(wr, zi), Ops::mul(wi, zr));
+      wr = wr_new;
+    }
+    zr = Ops::add(wr, cr);
+    zi = Ops::add(wi, ci);
+  }
+};
+
+struct BurningShip {
+  static constexpr int degree = 2;
+  static constexpr bool conjugate_symmetric = false;
+
+  template <class Ops>
+  static void step(typename Ops::real &zr,
+                   typename Ops::real &zi,
+                   typename Ops::real cr,
+                   typename Ops::real ci) {
+    const typename Ops::real zr_new =
+        Ops::add(Ops::sub(Ops::mul(zr, zr), Ops::mul(zi, zi)), cr);
+    zi = Ops::add(Ops::abs(Ops::mul(Ops::mul(Ops::set1(2.), zr), zi)), ci);
+    zr = zr_new;
+  }
+};
+
+struct Tricorn {
+  static constexpr int degree = 2;
+  static constexpr bool conjugate_symmetric = true;
+
+  template <class Ops>
+  static void step(typename Ops::real &zr,
+                   typename Ops::real &zi,
+                   typename Ops::real cr,
+                   typename Ops::real ci) {
+    const typename Ops::real zr_new =
+        Ops::add(Ops::sub(Ops::mul(zr, zr), Ops::mul(zi, zi)), cr);
+    zi = Ops::sub(ci, Ops::mul(Ops::mul(Ops::set1(2.), zr), zi));
+    zr = zr_new;
+  }
+};
+
+// Calls function with an object of the class of f. With a generic lambda
+// this picks the instantiation of a template once for a whole loop.
+template <class Function>
+auto dispatch(FORMULA f, Function &&function)
+    -> decltype(function(Quadratic())) {
+  switch (f) {
+  case MULTIBROT_3:
+    return function(Multibrot<3>());
+  case MULTIBROT_4:
+    return function(Multibrot<4>());
+  case BURNING_SHIP:
+    return function(BurningShip());
+  case TRICORN:
+    return function(Tricorn());
+  case MANDELBROT:
+    break;
+  }
+  return function(Quadratic());
+}
+
+inline int degree(FORMULA f) {
+  return f == MULTIBROT_3 ? 3 : (f == MULTIBROT_4 ? 4 : 2);
+}
+
+// The smooth iteration count of a point which escaped at iteration i with
+// |Z|^2 = magnitude, scaled by max_iterations like Mandelbrot::mandelbrot().
+inline double
+smooth(double i, double magnitude, double max_iterations, int degree) {
+  if (degree == 2) {
+    return (i - std::log2(std::log2(magnitude)) + 4.0) * max_iterations;
+  }
+  return (i - std::log(std::log2(magnitude)) / std::log(degree) + 4.0) *
+         max_iterations;
+}
+
+inline bool isConjugateSymmetric(FORMULA f) { return f != BURNING_SHIP; }
+
+} // namespace formula
+
+#endif
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <mandelbrot/hyperbolicComponents.h>
+
+const HyperbolicComponents &HyperbolicComponents::get() {
+  // thread safe initialization since C++11
+  static const HyperbolicComponents components;
+  return components;
+}
+
+HyperbolicComponents::HyperbolicComponents() {
+  // The components get smaller with the period and there are more of them,
+  // so split the squares of the higher periods less often. Period 3 is split
+  // 7 times which gives boxes of 1/128 of the component size.
+  constexpr int DEPTH_BUDGET = 10;
+  for (int period = 3; period <= MAX_PERIOD; period++) {
+    std::vector<double> nucleus_re, nucleus_im;
+    findNuclei(period, nucleus_re, nucleus_im);
+    for (size_t n = 0; n < nucleus_re.size(); n++) {
+      const std::complex<double> c(nucleus_re[n], nucleus_im[n]);
+      // Size estimate of the component, see Heyland-Allen "Practical
+      // interior distance rendering" 2013: 1 / (beta * lambda^2).
+      std::complex<double> z = 0.;
+      std::complex<double> lambda = 1.;
+      std::complex<double> beta = 1.;
+      for (int i = 1; i < period; i++) {
+        z = z * z + c;
+        lambda *= 2. * z;
+        beta += 1. / lambda;
+      }
+      const double size = std::abs(1. / (beta * lambda * lambda));
+      addBoxes(Box{Interval(c.real() - size, c.real() + size),
+                   Interval(c.imag() - size, c.imag() + size)},
+               period,
+               DEPTH_BUDGET - period);
+      num_components += c.imag() > 0. ? 2 : 1;
+    }
+  }
+
+  // the set is symmetric to the real axis
+  const size_t upper_boxes = boxes.size();
+  for (size_t b = 0; b < upper_boxes; b++) {
+    if (boxes[b].im.hi <= 0.) {
+      continue;
+    }
+    Box mirrored = boxes[b];
+    mirrored.im = Interval(-boxes[b].im.hi, -boxes[b].im.lo);
+    boxes.push_back(mirrored);
+  }
+
+  buildGrid();
+}
+
+void HyperbolicComponents::findNuclei(int period,
+                                      std::vector<double> &nucleus_re,
+                                      std::vector<double> &nucleus_im) {
+  // Newton's method on z_period(c) = 0 started from a grid over the upper
+  // half of the set. The grid is fine enough to hit the basins of all nuclei
+  // up to MAX_PERIOD.
+  constexpr int SEEDS_RE = 250;
+  constexpr int SEEDS_IM = 120;
+  constexpr int NEWTON_STEPS = 64;
+  for (int sy = 0; sy < SEEDS_IM; sy++) {
+    for (int sx = 0; sx < SEEDS_RE; sx++) {
+      std::complex<double> c(-2. + 2.5 * (sx + 0.5) / SEEDS_RE,
+                             1.2 * (sy + 0.5) / SEEDS_IM);
+      bool converged = false;
+      for (int step = 0; step < NEWTON_STEPS && !converged; step++) {
+        std::complex<double> z = 0.;
+        std::complex<double> dz = 0.;
+        for (int i = 0; i < period; i++) {
+          dz = 2. * z * dz + 1.;
+          z = z * z + c;
+        }
+        if (std::abs(dz) == 0. || !std::isfinite(std::abs(z))) {
+          break;
+        }
+        const std::complex<double> delta = z / dz;
+        c -= delta;
+        converged = std::abs(delta) < 1e-15;
+      }
+      if (!converged || c.imag() < -1e-12) {
+        continue;
+      }
+      if (std::abs(c.imag()) < 1e-12) {
+        c.imag(0.);
+      }
+
+      // the period must be exact, otherwise it is the nucleus of a divisor
+      std::complex<double> z = 0.;
+      bool exact = true;
+      for (int i = 1; i < period; i++) {
+        z = z * z + c;
+        if (std::abs(z) < 1e-9) {
+          exact = false;
+          break;
+        }
+      }
+      if (!exact) {
+        continue;
+      }
+
+      bool known = false;
+      for (size_t n = 0; n < nucleus_re.size() && !known; n++) {
+        known = std::abs(c - std::complex<double>(nucleus_re[n],
+                                                  nucleus_im[n])) < 1e-9;
+      }
+      if (!known) {
+        nucleus_re.push_back(c.real());
+        nucleus_im.push_back(c.imag());
+      }
+    }
+  }
+}
+
+void HyperbolicComponents::addBoxes(const Box &box, int period, int depth) {
+  if (isProvenInside(box, period)) {
+    boxes.push_back(box);
+    return;
+  }
+  if (depth == 0 || isProvenUninteresting(box)) {
+    return;
+  }
+  const double mid_re = 0.5 * (box.re.lo + box.re.hi);
+  const double mid_im = 0.5 * (box.im.lo + box.im.hi);
+  const Interval left(box.re.lo, mid_re);
+  const Interval right(mid_re, box.re.hi);
+  const Interval bottom(box.im.lo, mid_im);
+  const Interval top(mid_im, box.im.hi);
+  addBoxes(Box{left, bottom}, period, depth - 1);
+  addBoxes(Box{right, bottom}, period, depth - 1);
+  addBoxes(Box{left, top}, period, depth - 1);
+  addBoxes(Box{right, top}, period, depth - 1);
+}
+
+bool HyperbolicComponents::isProvenInside(const Box &box, int period) {
+  // Interval boxes of Z grow with every complex multiplication as they rotate,
+  // which is too much for periods above 2. Disks z + r do not have that
+  // problem: (z + r)^2 + c + r_c = z^2 + c + (2|z| + r) r + r_c.
+  // Iterating from Z = 0 the disks grow towards the attracting cycle, so a
+  // disk is never contained in the one period iterations before. Therefore
+  // the disk is inflated a bit after every period iterations and checked if
+  // the following period iterations map it into itself (epsilon inflation,
+  // see Rump "Verification methods" 2010). Near the border of the component
+  // the disk converges slowly or not at all, so give up after some rounds.
+  constexpr int MAX_ROUNDS = 30;
+  constexpr double INFLATION = 0.2;
+  // bound of the relative rounding error of the complex operations
+  constexpr double ULP = 4. * std::numeric_limits<double>::epsilon();
+  const std::complex<double> c(0.5 * (box.re.lo + box.re.hi),
+                               0.5 * (box.im.lo + box.im.hi));
+  const double c_radius =
+      std::hypot(box.re.hi - c.real(), box.im.hi - c.imag()) * (1. + ULP) +
+      ULP * std::abs(c);
+  std::complex<double> z = 0.;
+  double r = 0.;
+  for (int round = 0; round < MAX_ROUNDS; round++) {
+    const std::complex<double> z_start = z;
+    const double r_start = r * (1. + INFLATION) + 1e-14;
+    r = r_start;
+    for (int i = 0; i < period; i++) {
+      const double abs_z = std::abs(z);
+      z = z * z + c;
+      r = ((2. * abs_z + r) * r + c_radius) * (1. + ULP) +
+          ULP * (abs_z * abs_z + std::abs(c));
+      if (std::abs(z) + r > 2.) {
+        return false;
+      }
+    }
+    // The start disk contains Z of the orbit of every c of the box. If it
+    // maps into itself, none of these orbits can escape.
+    if (std::abs(z - z_start) * (1. + ULP) + r < r_start) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HyperbolicComponents::isProvenUninteresting(const Box &box) {
+  // see Mandelbrot::classifyTile()
+  constexpr int MAX_ITERATIONS = 64;
+  const Interval c2 = sqr(box.re) + sqr(box.im);
+  const Interval m1 = Interval(256.) * sqr(c2) - Interval(96.) * c2 +
+                      Interval(32.) * box.re - Interval(3.);
+  const Interval m2 = sqr(box.re + Interval(1.)) + sqr(box.im);
+  if (m1.hi < 0. || m2.hi < 1. / 16.) {
+    return true;
+  }
+  Interval zr, zi;
+  for (int i = 0; i < MAX_ITERATIONS; i++) {
+    const Interval zr_new = sqr(zr) - sqr(zi) + box.re;
+    zi = Interval(2.) * zr * zi + box.im;
+    zr = zr_new;
+    if ((sqr(zr) + sqr(zi)).lo > 4.) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void HyperbolicComponents::buildGrid() {
+  std::vector<std::vector<int>> cells(GRID_SIZE * GRID_SIZE);
+  const double scale = GRID_SIZE / GRID_EXTENT;
+  for (size_t b = 0; b < boxes.size(); b++) {
+    const Box &box = boxes[b];
+    const int x0 = std::max(
+        0, static_cast<int>(std::floor((box.re.lo - GRID_MIN_RE) * scale)));
+    const int x1 = std::min(
+        GRID_SIZE - 1,
+        static_cast<int>(std::floor((box.re.hi - GRID_MIN_RE) * scale)));
+    const int y0 = std::max(
+        0,
+        static_cast<int>(std::floor((box.im.lo + GRID_EXTENT / 2) * scale)));
+    const int y1 = std::min(
+        GRID_SIZE - 1,
+        static_cast<int>(std::floor((box.im.hi + GRID_EXTENT / 2) * scale)));
+    for (int y = y0; y <= y1; y++) {
+      for (int x = x0; x <= x1; x++) {
+        cells[y * GRID_SIZE + x].push_back(static_cast<int>(b));
+      }
+    }
+  }
+  cell_begin.clear();
+  cell_boxes.clear();
+  for (const auto &cell : cells) {
+    cell_begin.push_back(static_cast<int>(cell_boxes.size()));
+    cell_boxes.insert(cell_boxes.end(), cell.begin(), cell.end());
+  }
+  cell_begin.push_back(static_cast<int>(cell_boxes.size()));
+}
+
+bool HyperbolicComponents::isInside(const Interval &re,
+                                    const Interval &im) const {
+  // a box containing the rectangle also contains its corner
+  const int cell = cellIndex(re.lo, im.lo);
+  if (cell < 0) {
+    return false;
+  }
+  for (int i = cell_begin[cell]; i < cell_begin[cell + 1]; i++) {
+    const Box &box = boxes[cell_boxes[i]];
+    if (box.re.contains(re) && box.im.contains(im)) {
+      return true;
+    }
+  }
+  return false;
+}
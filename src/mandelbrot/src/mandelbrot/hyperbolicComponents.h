@@ -0,0 +1,90 @@
+#ifndef HYPERBOLIC_COMPONENTS_H
+#define HYPERBOLIC_COMPONENTS_H
+
+#include <mandelbrot/interval.hpp>
+#include <vector>
+
+// Lookup table of the interior of the biggest hyperbolic components beside M1
+// and M2: the bulbs and mini mandelbrots of period 3 to MAX_PERIOD. For every
+// nucleus a square of the estimated component size around it is subdivided
+// into boxes and each box is proven to be inside: If a disk containing Z maps
+// into itself after period iterations for all c of the box, no c of the box
+// can escape. So unlike an approximation by disks or cardioids the lookup
+// never classifies an outside point as inside, it only misses the parts of
+// the components close to their border.
+class HyperbolicComponents {
+public:
+  static constexpr int MAX_PERIOD = 7;
+
+  // The table is build on the first call, which takes some 300ms.
+  static const HyperbolicComponents &get();
+
+  // True if c lies in one of the proven boxes. Thread safe.
+  bool isInside(double re, double im) const {
+    const int cell = cellIndex(re, im);
+    if (cell < 0) {
+      return false;
+    }
+    for (int i = cell_begin[cell]; i < cell_begin[cell + 1]; i++) {
+      const Box &box = boxes[cell_boxes[i]];
+      if (box.re.lo <= re && re <= box.re.hi && box.im.lo <= im &&
+          im <= box.im.hi) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // True if the whole rectangle lies in one of the proven boxes.
+  bool isInside(const Interval &re, const Interval &im) const;
+
+  // Number of nuclei found and proven boxes.
+  int getNumComponents() const { return num_components; }
+  int getNumBoxes() const { return static_cast<int>(boxes.size()); }
+
+private:
+  struct Box {
+    Interval re, im;
+  };
+
+  HyperbolicComponents();
+
+  // All nuclei with imaginary part >= 0 of the given period.
+  static void findNuclei(int period,
+                         std::vector<double> &nucleus_re,
+                         std::vector<double> &nucleus_im);
+
+  // Adds the proven boxes of the given square, split depth times at most.
+  void addBoxes(const Box &box, int period, int depth);
+
+  static bool isProvenInside(const Box &box, int period);
+
+  // True if the whole box lies in M1, M2 or escapes.
+  static bool isProvenUninteresting(const Box &box);
+
+  // The boxes are sorted into a grid of GRID_SIZE x GRID_SIZE cells covering
+  // [GRID_MIN_RE, GRID_MIN_RE + GRID_EXTENT] x [-GRID_EXTENT / 2, ...].
+  static constexpr int GRID_SIZE = 256;
+  static constexpr double GRID_MIN_RE = -2.;
+  static constexpr double GRID_EXTENT = 2.5;
+
+  void buildGrid();
+
+  int cellIndex(double re, double im) const {
+    const double scale = GRID_SIZE / GRID_EXTENT;
+    const double x = (re - GRID_MIN_RE) * scale;
+    const double y = (im + GRID_EXTENT / 2) * scale;
+    if (!(x >= 0. && x < GRID_SIZE && y >= 0. && y < GRID_SIZE)) {
+      return -1;
+    }
+    return static_cast<int>(y) * GRID_SIZE + static_cast<int>(x);
+  }
+
+  std::vector<Box> boxes;
+  // boxes of cell i are cell_boxes[cell_begin[i] ... cell_begin[i + 1] - 1]
+  std::vector<int> cell_begin;
+  std::vector<int> cell_boxes;
+  int num_components = 0;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef INTERVAL_HPP
+#define INTERVAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Closed interval [lo, hi] of doubles. Every operation rounds its bounds one
+// ulp outwards, so the result contains the exact result for all points of the
+// operands although the FPU rounds to nearest. See Moore "Interval Analysis"
+// 1966.
+
+struct Interval {
+  double lo = 0.;
+  double hi = 0.;
+
+  Interval() {}
+  Interval(double d) : lo(d), hi(d) {}
+  Interval(double l, double h) : lo(l), hi(h) {}
+
+  bool contains(const Interval &other) const {
+    return lo <= other.lo && other.hi <= hi;
+  }
+};
+
+namespace interval {
+
+inline Interval outwards(double lo, double hi) {
+  constexpr double INF = std::numeric_limits<double>::infinity();
+  return Interval(std::nextafter(lo, -INF), std::nextafter(hi, INF));
+}
+
+} // namespace interval
+
+inline Interval operator+(const Interval &a, const Interval &b) {
+  return interval::outwards(a.lo + b.lo, a.hi + b.hi);
+}
+
+inline Interval operator-(const Interval &a, const Interval &b) {
+  return interval::outwards(a.lo - b.hi, a.hi - b.lo);
+}
+
+inline Interval operator*(const Interval &a, const Interval &b) {
+  const double p1 = a.lo * b.lo;
+  const double p2 = a.lo * b.hi;
+  const double p3 = a.hi * b.lo;
+  const double p4 = a.hi * b.hi;
+  return interval::outwards(std::min(std::min(p1, p2), std::min(p3, p4)),
+                            std::max(std::max(p1, p2), std::max(p3, p4)));
+}
+
+// Tighter than a * a: The square of an interval containing 0 starts at 0.
+inline Interval sqr(const Interval &a) {
+  const double l = a.lo * a.lo;
+  const double h = a.hi * a.hi;
+  if (a.lo <= 0. && 0. <= a.hi) {
+    return interval::outwards(0., std::max(l, h));
+  }
+  return interval::outwards(std::min(l, h), std::max(l, h));
+}
+
+#endif
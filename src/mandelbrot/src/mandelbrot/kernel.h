@@ -0,0 +1,75 @@
+#ifndef MANDELBROT_KERNEL_H
+#define MANDELBROT_KERNEL_H
+
+#include <mandelbrot/formula.hpp>
+
+namespace kernel {
+
+struct EscapeTimeParams {
+  formula::FORMULA formula = formula::MANDELBROT;
+  unsigned int max_iterations = 0;
+  bool smoothing = false;
+  bool periodicity_check = false;
+  double periodicity_epsilon = 0.;
+
+  // Iterate the Julia set of c = (julia_re, julia_im) instead: the points are
+  // the start values of Z and c is the same for all of them. There is no
+  // M1/M2 test for Julia sets.
+  bool julia = false;
+  double julia_re = 0.;
+  double julia_im = 0.;
+
+  // Optional state to continue iterating later. If zr and zi are set, point i
+  // starts with Z = (zr[i], zi[i]) at iteration start_iteration and its final
+  // Z is written back. (saved_zr[i], saved_zi[i]) is the Z the periodicity
+  // check compares with, see Mandelbrot::iterate(), and is written back as
+  // well. Start both with the same Z. unresolved[i] is set to 1 if the point
+  // neither escaped nor was classified as inside until max_iterations, 0
+  // otherwise.
+  unsigned int start_iteration = 0;
+  double *zr = nullptr;
+  double *zi = nullptr;
+  double *saved_zr = nullptr;
+  double *saved_zi = nullptr;
+  unsigned char *unresolved = nullptr;
+};
+
+// Evaluates the n points (re[i], im[i]) and writes the same value
+// Mandelbrot::mandelbrot() would return for each of them into result[i].
+// Returns the number of points stopped by the periodicity check.
+typedef int (*EscapeTimeBatch)(const EscapeTimeParams &params,
+                                const double *re,
+                                const double *im,
+                                int n,
+                                double *result);
+
+// Only defined if the library was build with MANDELBROT_SIMD_X86. The caller
+// has to make sure the CPU supports the instruction set before calling.
+int escapeTimeAVX2(const EscapeTimeParams &params,
+                   const double *re,
+                   const double *im,
+                   int n,
+                   double *result);
+
+int escapeTimeAVX512(const EscapeTimeParams &params,
+                     const double *re,
+                     const double *im,
+                     int n,
+                     double *result);
+
+// Same as above but iterating in single precision with twice the lanes.
+int escapeTimeAVX2Float(const EscapeTimeParams &params,
+                        const double *re,
+                        const double *im,
+                        int n,
+                        double *result);
+
+int escapeTimeAVX512Float(const EscapeTimeParams &params,
+                          const double *re,
+                          const double *im,
+                          int n,
+                          double *result);
+
+}  // namespace kernel
+
+#endif
@@ -0,0 +1,112 @@
+#include <immintrin.h>
+#include <mandelbrot/escapeTimeKernel.hpp>
+
+// This file is compiled with -mavx2 (see CMakeLists.txt). Nothing in here must
+// be called before checking the CPU supports AVX2.
+
+namespace kernel {
+namespace {
+
+struct PackAVX2 {
+  typedef double scalar;
+  typedef __m256d real;
+  typedef __m256d mask;
+  static constexpr int width = 4;
+
+  static real set1(double v) { return _mm256_set1_pd(v); }
+  static real load(const double *p) { return _mm256_loadu_pd(p); }
+  static void store(double *p, real v) { _mm256_storeu_pd(p, v); }
+
+  static real add(real a, real b) { return _mm256_add_pd(a, b); }
+  static real sub(real a, real b) { return _mm256_sub_pd(a, b); }
+  static real mul(real a, real b) { return _mm256_mul_pd(a, b); }
+  static real abs(real a) {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.), a);
+  }
+
+  static mask less(real a, real b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static mask greater(real a, real b) {
+    return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+  }
+  static mask allTrue() {
+    return _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  }
+  static mask allFalse() { return _mm256_setzero_pd(); }
+  static mask andMask(mask a, mask b) { return _mm256_and_pd(a, b); }
+  static mask orMask(mask a, mask b) { return _mm256_or_pd(a, b); }
+  // a & ~b
+  static mask andNotMask(mask a, mask b) { return _mm256_andnot_pd(b, a); }
+  static bool any(mask m) { return _mm256_movemask_pd(m) != 0; }
+  static int bits(mask m) { return _mm256_movemask_pd(m); }
+
+  // m ? a : b
+  static real select(mask m, real a, real b) {
+    return _mm256_blendv_pd(b, a, m);
+  }
+  // m ? a + b : a
+  static real addIf(mask m, real a, real b) {
+    return _mm256_add_pd(a, _mm256_and_pd(m, b));
+  }
+};
+
+struct PackAVX2Float {
+  typedef float scalar;
+  typedef __m256 real;
+  typedef __m256 mask;
+  static constexpr int width = 8;
+
+  static real set1(double v) { return _mm256_set1_ps(static_cast<float>(v)); }
+  static real load(const double *p) {
+    const __m128 low = _mm256_cvtpd_ps(_mm256_loadu_pd(p));
+    const __m128 high = _mm256_cvtpd_ps(_mm256_loadu_pd(p + 4));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+  }
+  static void store(float *p, real v) { _mm256_storeu_ps(p, v); }
+
+  static real add(real a, real b) { return _mm256_add_ps(a, b); }
+  static real sub(real a, real b) { return _mm256_sub_ps(a, b); }
+  static real mul(real a, real b) { return _mm256_mul_ps(a, b); }
+  static real abs(real a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+
+  static mask less(real a, real b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static mask greater(real a, real b) {
+    return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+  }
+  static mask allTrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+  static mask allFalse() { return _mm256_setzero_ps(); }
+  static mask andMask(mask a, mask b) { return _mm256_and_ps(a, b); }
+  static mask orMask(mask a, mask b) { return _mm256_or_ps(a, b); }
+  // a & ~b
+  static mask andNotMask(mask a, mask b) { return _mm256_andnot_ps(b, a); }
+  static bool any(mask m) { return _mm256_movemask_ps(m) != 0; }
+  static int bits(mask m) { return _mm256_movemask_ps(m); }
+
+  // m ? a : b
+  static real select(mask m, real a, real b) {
+    return _mm256_blendv_ps(b, a, m);
+  }
+  // m ? a + b : a
+  static real addIf(mask m, real a, real b) {
+    return _mm256_add_ps(a, _mm256_and_ps(m, b));
+  }
+};
+
+}  // namespace
+
+int escapeTimeAVX2(const EscapeTimeParams &params,
+                   const double *re,
+                   const double *im,
+                   int n,
+                   double *result) {
+  return escapeTime<PackAVX2>(params, re, im, n, result);
+}
+
+int escapeTimeAVX2Float(const EscapeTimeParams &params,
+                        const double *re,
+                        const double *im,
+                        int n,
+                        double *result) {
+  return escapeTime<PackAVX2Float>(params, re, im, n, result);
+}
+
+}  // namespace kernel
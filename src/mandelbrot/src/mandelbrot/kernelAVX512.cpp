@@ -0,0 +1,115 @@
+#include <immintrin.h>
+#include <mandelbrot/escapeTimeKernel.hpp>
+
+// This file is compiled with -mavx512f (see CMakeLists.txt). Nothing in here
+// must be called before checking the CPU supports AVX-512F.
+
+namespace kernel {
+namespace {
+
+struct PackAVX512 {
+  typedef double scalar;
+  typedef __m512d real;
+  typedef __mmask8 mask;
+  static constexpr int width = 8;
+
+  static real set1(double v) { return _mm512_set1_pd(v); }
+  static real load(const double *p) { return _mm512_loadu_pd(p); }
+  static void store(double *p, real v) { _mm512_storeu_pd(p, v); }
+
+  static real add(real a, real b) { return _mm512_add_pd(a, b); }
+  static real sub(real a, real b) { return _mm512_sub_pd(a, b); }
+  static real mul(real a, real b) { return _mm512_mul_pd(a, b); }
+  static real abs(real a) { return _mm512_abs_pd(a); }
+
+  static mask less(real a, real b) {
+    return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+  }
+  static mask greater(real a, real b) {
+    return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);
+  }
+  static mask allTrue() { return 0xFF; }
+  static mask allFalse() { return 0; }
+  static mask andMask(mask a, mask b) { return a & b; }
+  static mask orMask(mask a, mask b) { return a | b; }
+  // a & ~b
+  static mask andNotMask(mask a, mask b) { return a & ~b; }
+  static bool any(mask m) { return m != 0; }
+  static int bits(mask m) { return m; }
+
+  // m ? a : b
+  static real select(mask m, real a, real b) {
+    return _mm512_mask_blend_pd(m, b, a);
+  }
+  // m ? a + b : a
+  static real addIf(mask m, real a, real b) {
+    return _mm512_mask_add_pd(a, m, a, b);
+  }
+};
+
+struct PackAVX512Float {
+  typedef float scalar;
+  typedef __m512 real;
+  typedef __mmask16 mask;
+  static constexpr int width = 16;
+
+  static real set1(double v) { return _mm512_set1_ps(static_cast<float>(v)); }
+  static real load(const double *p) {
+    const __m256 low = _mm512_cvtpd_ps(_mm512_loadu_pd(p));
+    const __m256 high = _mm512_cvtpd_ps(_mm512_loadu_pd(p + 8));
+    // AVX-512F has no 256 bit float insert, the double one moves the same bits
+    return _mm512_castpd_ps(_mm512_insertf64x4(
+        _mm512_castps_pd(_mm512_castps256_ps512(low)), _mm256_castps_pd(high),
+        1));
+  }
+  static void store(float *p, real v) { _mm512_storeu_ps(p, v); }
+
+  static real add(real a, real b) { return _mm512_add_ps(a, b); }
+  static real sub(real a, real b) { return _mm512_sub_ps(a, b); }
+  static real mul(real a, real b) { return _mm512_mul_ps(a, b); }
+  static real abs(real a) { return _mm512_abs_ps(a); }
+
+  static mask less(real a, real b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+  }
+  static mask greater(real a, real b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+  }
+  static mask allTrue() { return 0xFFFF; }
+  static mask allFalse() { return 0; }
+  static mask andMask(mask a, mask b) { return a & b; }
+  static mask orMask(mask a, mask b) { return a | b; }
+  // a & ~b
+  static mask andNotMask(mask a, mask b) { return a & ~b; }
+  static bool any(mask m) { return m != 0; }
+  static int bits(mask m) { return m; }
+
+  // m ? a : b
+  static real select(mask m, real a, real b) {
+    return _mm512_mask_blend_ps(m, b, a);
+  }
+  // m ? a + b : a
+  static real addIf(mask m, real a, real b) {
+    return _mm512_mask_add_ps(a, m, a, b);
+  }
+};
+
+}  // namespace
+
+int escapeTimeAVX512(const EscapeTimeParams &params,
+                     const double *re,
+                     const double *im,
+                     int n,
+                     double *result) {
+  return escapeTime<PackAVX512>(params, re, im, n, result);
+}
+
+int escapeTimeAVX512Float(const EscapeTimeParams &params,
+                          const double *re,
+                          const double *im,
+                          int n,
+                          double *result) {
+  return escapeTime<PackAVX512Float>(params, re, im, n, result);
+}
+
+}  // namespace kernel
@@ -4,6 +4,12 @@
 Mandelbrot::Mandelbrot() {
   setMaxIterations(100);
   initRedistributionSpline();
+  // use the widest vector unit available
+  if (!setVectorization(VECTORIZATION::AVX512)) {
+    if (!setVectorization(VECTORIZATION::AVX2)) {
+      setVectorization(VECTORIZATION::SCALAR);
+    }
+  }
 }
 
 double Mandelbrot::mandelbrot(const Eigen::Vector2d &position) const {
@@ -13,75 +19,815 @@ double Mandelbrot::mandelbrot(const Eigen::Vector2d &position) const {
   return mandelbrot_classic(position);
 }
 
+double Mandelbrot::mandelbrot(const Eigen::Vector2f &position) const {
+  if (smooting) {
+    return mandelbrot_smooth(position);
+  }
+  return mandelbrot_classic(position);
+}
+
 double Mandelbrot::mandelbrot(int x, int y) const {
   const Eigen::Vector2d P(x, y);
   return mandelbrot(P);
 }
 
-double Mandelbrot::mandelbrot_classic(const Eigen::Vector2d &position) const {
-  if (isInsideM1M2(position)) {
+void Mandelbrot::mandelbrot(const double *re,
+                            const double *im,
+                            int n,
+                            double *result) const {
+  if (escape_time_batch == nullptr) {
+    scalarBatch<double>(re, im, n, result);
+    return;
+  }
+  mandelbrot(escape_time_batch, re, im, n, result);
+}
+
+void Mandelbrot::mandelbrotSinglePrecision(const double *re,
+                                           const double *im,
+                                           int n,
+                                           double *result) const {
+  if (escape_time_batch_float == nullptr) {
+    scalarBatch<float>(re, im, n, result);
+    return;
+  }
+  mandelbrot(escape_time_batch_float, re, im, n, result);
+}
+
+void Mandelbrot::mandelbrot(const double *re,
+                            const double *im,
+                            int n,
+                            unsigned int start_iteration,
+                            double *zr,
+                            double *zi,
+                            double *saved_zr,
+                            double *saved_zi,
+                            unsigned char *unresolved,
+                            double *result) const {
+  if (escape_time_batch == nullptr) {
+    for (int i = 0; i < n; i++) {
+      result[i] = resume(Eigen::Vector2d(re[i], im[i]),
+                         start_iteration,
+                         zr[i],
+                         zi[i],
+                         saved_zr[i],
+                         saved_zi[i],
+                         unresolved[i]);
+    }
+    return;
+  }
+  mandelbrot(escape_time_batch,
+             re,
+             im,
+             n,
+             start_iteration,
+             zr,
+             zi,
+             saved_zr,
+             saved_zi,
+             unresolved,
+             result);
+}
+
+void Mandelbrot::mandelbrotSinglePrecision(const double *re,
+                                           const double *im,
+                                           int n,
+                                           unsigned int start_iteration,
+                                           double *zr,
+                                           double *zi,
+                                           double *saved_zr,
+                                           double *saved_zi,
+                                           unsigned char *unresolved,
+                                           double *result) const {
+  if (escape_time_batch_float == nullptr) {
+    for (int i = 0; i < n; i++) {
+      result[i] = resume(Eigen::Vector2f(re[i], im[i]),
+                         start_iteration,
+                         zr[i],
+                         zi[i],
+                         saved_zr[i],
+                         saved_zi[i],
+                         unresolved[i]);
+    }
+    return;
+  }
+  mandelbrot(escape_time_batch_float,
+             re,
+             im,
+             n,
+             start_iteration,
+             zr,
+             zi,
+             saved_zr,
+             saved_zi,
+             unresolved,
+             result);
+}
+
+void Mandelbrot::julia(double c_re,
+                       double c_im,
+                       const double *re,
+                       const double *im,
+                       int n,
+                       double *result) const {
+  if (escape_time_batch == nullptr) {
+    const Eigen::Vector2d c(c_re, c_im);
+    for (int i = 0; i < n; i++) {
+      result[i] = julia(c, Eigen::Vector2d(re[i], im[i]));
+    }
+    return;
+  }
+  kernel::EscapeTimeParams params;
+  params.formula = iteration_formula;
+  params.max_iterations = max_iterations;
+  params.smoothing = smooting;
+  params.periodicity_check = periodicity_check;
+  params.periodicity_epsilon = periodicity_epsilon;
+  params.julia = true;
+  params.julia_re = c_re;
+  params.julia_im = c_im;
+  const int shortcuts = escape_time_batch(params, re, im, n, result);
+  if (shortcuts > 0) {
+    periodicity_shortcuts.fetch_add(shortcuts, std::memory_order_relaxed);
+  }
+}
+
+double Mandelbrot::julia(const Eigen::Vector2d &c,
+                         const Eigen::Vector2d &z0) const {
+  // same as mandelbrot_classic() and mandelbrot_smooth() starting at Z = z0
+  const double G = smooting ? 256.0 * 256.0 : 4.;
+  Eigen::Vector2d Zn = z0;
+  Eigen::Vector2d Z_saved = z0;
+  double i = 0.;
+  if (!iterate(c, G, Zn, Z_saved, i)) {
+    return smooting ? 0 : max_iterations;
+  }
+  if (!smooting) {
+    return i;
+  }
+  if (i > max_iterations - 1) {
     return 0;
   }
-  Eigen::Vector2d Zn(0.0, 0.0);
-  const double G = 4;
+  const double magnitude = Zn.dot(Zn);
+  return formula::smooth(
+      i, magnitude, max_iterations, formula::degree(iteration_formula));
+}
+
+void Mandelbrot::mandelbrot(kernel::EscapeTimeBatch batch,
+                            const double *re,
+                            const double *im,
+                            int n,
+                            unsigned int start_iteration,
+                            double *zr,
+                            double *zi,
+                            double *saved_zr,
+                            double *saved_zi,
+                            unsigned char *unresolved,
+                            double *result) const {
+  kernel::EscapeTimeParams params;
+  params.formula = iteration_formula;
+  params.max_iterations = max_iterations;
+  params.smoothing = smooting;
+  params.periodicity_check = periodicity_check;
+  params.periodicity_epsilon = periodicity_epsilon;
+  params.start_iteration = start_iteration;
+  params.zr = zr;
+  params.zi = zi;
+  params.saved_zr = saved_zr;
+  params.saved_zi = saved_zi;
+  params.unresolved = unresolved;
+
+  // Like the stateless overload below. The points continuing a state were
+  // looked up when they started.
+  int first_inside = start_iteration > 0 ? n : 0;
+  while (first_inside < n &&
+         !isInsideComponent(re[first_inside], im[first_inside])) {
+    first_inside++;
+  }
+  int shortcuts = first_inside > 0 ? batch(params, re, im, first_inside, result)
+                                   : 0;
+  const double inside_value = smooting ? 0. : max_iterations;
+  int outside[COMPONENT_CHUNK];
+  double outside_re[COMPONENT_CHUNK], outside_im[COMPONENT_CHUNK];
+  double outside_zr[COMPONENT_CHUNK], outside_zi[COMPONENT_CHUNK];
+  double outside_saved_zr[COMPONENT_CHUNK], outside_saved_zi[COMPONENT_CHUNK];
+  unsigned char outside_unresolved[COMPONENT_CHUNK];
+  double outside_result[COMPONENT_CHUNK];
+  params.zr = outside_zr;
+  params.zi = outside_zi;
+  params.saved_zr = outside_saved_zr;
+  params.saved_zi = outside_saved_zi;
+  params.unresolved = outside_unresolved;
+  int num_inside = 0;
+  int i = first_inside;
+  while (i < n) {
+    int num_outside = 0;
+    for (; i < n && num_outside < COMPONENT_CHUNK; i++) {
+      if (isInsideComponent(re[i], im[i])) {
+        // resolved, the state stays at its start
+        result[i] = inside_value;
+        unresolved[i] = 0;
+        num_inside++;
+      } else {
+        outside[num_outside] = i;
+        outside_re[num_outside] = re[i];
+        outside_im[num_outside] = im[i];
+        outside_zr[num_outside] = zr[i];
+        outside_zi[num_outside] = zi[i];
+        outside_saved_zr[num_outside] = saved_zr[i];
+        outside_saved_zi[num_outside] = saved_zi[i];
+        num_outside++;
+      }
+    }
+    if (num_outside == 0) {
+      continue;
+    }
+    shortcuts +=
+        batch(params, outside_re, outside_im, num_outside, outside_result);
+    for (int k = 0; k < num_outside; k++) {
+      result[outside[k]] = outside_result[k];
+      zr[outside[k]] = outside_zr[k];
+      zi[outside[k]] = outside_zi[k];
+      saved_zr[outside[k]] = outside_saved_zr[k];
+      saved_zi[outside[k]] = outside_saved_zi[k];
+      unresolved[outside[k]] = outside_unresolved[k];
+    }
+  }
+  if (num_inside > 0) {
+    component_shortcuts.fetch_add(num_inside, std::memory_order_relaxed);
+  }
+  if (shortcuts > 0) {
+    periodicity_shortcuts.fetch_add(shortcuts, std::memory_order_relaxed);
+  }
+}
 
-  double i = 0;
+template <typename T>
+double Mandelbrot::resume(const Eigen::Matrix<T, 2, 1> &position,
+                          unsigned int start_iteration,
+                          double &zr,
+                          double &zi,
+                          double &saved_zr,
+                          double &saved_zi,
+                          unsigned char &unresolved) const {
+  // Same as mandelbrot_classic() and mandelbrot_smooth() but starting from
+  // the given state. Like the batches it looks up the components only for
+  // the points which start.
+  unresolved = 0;
+  if (iteration_formula == formula::MANDELBROT && isInsideM1M2(position)) {
+    return 0;
+  }
+  if (start_iteration == 0 && isInsideComponent(position.x(), position.y())) {
+    component_shortcuts.fetch_add(1, std::memory_order_relaxed);
+    return smooting ? 0 : max_iterations;
+  }
+  const T G = smooting ? 256.0 * 256.0 : 4.;
+  Eigen::Matrix<T, 2, 1> Zn(zr, zi);
+  Eigen::Matrix<T, 2, 1> Z_saved(saved_zr, saved_zi);
+  double i = start_iteration;
+  const bool periodic = !iterate(position, G, Zn, Z_saved, i);
+  zr = Zn.x();
+  zi = Zn.y();
+  saved_zr = Z_saved.x();
+  saved_zi = Z_saved.y();
+  if (periodic) {
+    return smooting ? 0 : max_iterations;
+  }
+  const bool escaped = Zn.dot(Zn) > G;
+  unresolved = escaped ? 0 : 1;
+  if (!smooting) {
+    return i;
+  }
+  if (!escaped || i > max_iterations - 1) {
+    return 0;
+  }
+  const double magnitude = Zn.dot(Zn);
+  return formula::smooth(
+      i, magnitude, max_iterations, formula::degree(iteration_formula));
+}
+
+void Mandelbrot::mandelbrot(kernel::EscapeTimeBatch batch,
+                            const double *re,
+                            const double *im,
+                            int n,
+                            double *result) const {
+  kernel::EscapeTimeParams params;
+  params.formula = iteration_formula;
+  params.max_iterations = max_iterations;
+  params.smoothing = smooting;
+  params.periodicity_check = periodicity_check;
+  params.periodicity_epsilon = periodicity_epsilon;
+
+  // The kernels can not look up the components, so the points inside are
+  // removed before. The points up to the first inside one are given to the
+  // kernel in one piece, the others in chunks gathered on the stack.
+  int first_inside = 0;
+  while (first_inside < n &&
+         !isInsideComponent(re[first_inside], im[first_inside])) {
+    first_inside++;
+  }
+  int shortcuts = first_inside > 0 ? batch(params, re, im, first_inside, result)
+                                   : 0;
+  const double inside_value = smooting ? 0. : max_iterations;
+  int outside[COMPONENT_CHUNK];
+  double outside_re[COMPONENT_CHUNK], outside_im[COMPONENT_CHUNK];
+  double outside_result[COMPONENT_CHUNK];
+  int num_inside = 0;
+  int i = first_inside;
+  while (i < n) {
+    int num_outside = 0;
+    for (; i < n && num_outside < COMPONENT_CHUNK; i++) {
+      if (isInsideComponent(re[i], im[i])) {
+        result[i] = inside_value;
+        num_inside++;
+      } else {
+        outside[num_outside] = i;
+        outside_re[num_outside] = re[i];
+        outside_im[num_outside] = im[i];
+        num_outside++;
+      }
+    }
+    if (num_outside == 0) {
+      continue;
+    }
+    shortcuts +=
+        batch(params, outside_re, outside_im, num_outside, outside_result);
+    for (int k = 0; k < num_outside; k++) {
+      result[outside[k]] = outside_result[k];
+    }
+  }
+  if (num_inside > 0) {
+    component_shortcuts.fetch_add(num_inside, std::memory_order_relaxed);
+  }
+  if (shortcuts > 0) {
+    periodicity_shortcuts.fetch_add(shortcuts, std::memory_order_relaxed);
+  }
+}
+
+bool Mandelbrot::isInsideComponent(double re, double im) const {
+  // the components are the ones of z^2 + c
+  return component_lookup && iteration_formula == formula::MANDELBROT &&
+         HyperbolicComponents::get().isInside(re, im);
+}
+
+double Mandelbrot::mandelbrot(const DoubleDouble &re,
+                              const DoubleDouble &im) const {
+  if (isInsideM1M2(Eigen::Vector2d(re.toDouble(), im.toDouble()))) {
+    return 0;
+  }
+  const double G = smooting ? 256.0 * 256.0 : 4.;
+
+  DoubleDouble zr, zi;
+  DoubleDouble zr2, zi2;
+  DoubleDouble zr_saved, zi_saved;
+  double save_at = 1;
+  double magnitude = 0.;
+  double i = 0.;
   for (; i < max_iterations; i++) {
-    mandelbrotIteration(position, Zn);
-    if (Zn.dot(Zn) > G) {
+    zi = zr * zi * 2. + im;
+    zr = zr2 - zi2 + re;
+    zr2 = zr * zr;
+    zi2 = zi * zi;
+    // the escape test does not need the extra precision
+    magnitude = zr2.hi + zi2.hi;
+    if (magnitude > G) {
       break;
     }
+    if (periodicity_check) {
+      // see iterate()
+      if (std::abs((zr - zr_saved).hi) < periodicity_epsilon &&
+          std::abs((zi - zi_saved).hi) < periodicity_epsilon) {
+        periodicity_shortcuts.fetch_add(1, std::memory_order_relaxed);
+        return smooting ? 0 : max_iterations;
+      }
+      if (i == save_at) {
+        zr_saved = zr;
+        zi_saved = zi;
+        save_at *= 2;
+      }
+    }
   }
-  return i;
-}
 
-double Mandelbrot::mandelbrot_smooth(const Eigen::Vector2d &position) const {
-  if (isInsideM1M2(position)) {
+  if (!smooting) {
+    return i;
+  }
+  if (i > max_iterations - 1) {
     return 0;
   }
-  Eigen::Vector2d Zn(0.0, 0.0);
-  const double G = 256.0 * 256.0; // 2*2
+  return (i - std::log2(std::log2(magnitude)) + 4.0) * max_iterations;
+}
+
+void Mandelbrot::mandelbrot(const DoubleDouble &origin_re,
+                            const DoubleDouble &origin_im,
+                            const double *re,
+                            const double *im,
+                            int n,
+                            double *result) const {
+  for (int i = 0; i < n; i++) {
+    result[i] = mandelbrot(origin_re + re[i], origin_im + im[i]);
+  }
+}
 
+double Mandelbrot::mandelbrot(const FixedPoint &re,
+                              const FixedPoint &im) const {
+  const Eigen::Vector2d c(re.toDouble(), im.toDouble());
+  if (isInsideM1M2(c)) {
+    return 0;
+  }
+  // 4.124 overflows at 8: Once a component of Z is above 2 it escaped, else
+  // the squares are at most 4 and the new Z at most 6.
+  const FixedPoint two(2.);
+  const FixedPoint four(4.);
+  const FixedPoint epsilon(periodicity_epsilon);
+
+  FixedPoint zr, zi;
+  FixedPoint zr2, zi2;
+  FixedPoint zr_saved, zi_saved;
+  double save_at = 1;
   double i = 0.;
+  bool escaped = false;
   for (; i < max_iterations; i++) {
-    mandelbrotIteration(position, Zn);
-    if (Zn.dot(Zn) > G) {
+    const FixedPoint zrzi = zr * zi;
+    zi = zrzi + zrzi + im;
+    zr = zr2 - zi2 + re;
+    if (abs(zr) > two || abs(zi) > two) {
+      escaped = true;
       break;
     }
+    zr2 = zr * zr;
+    zi2 = zi * zi;
+    if (zr2 > four - zi2) {
+      escaped = true;
+      break;
+    }
+    if (periodicity_check) {
+      // see iterate()
+      if (abs(zr - zr_saved) < epsilon && abs(zi - zi_saved) < epsilon) {
+        periodicity_shortcuts.fetch_add(1, std::memory_order_relaxed);
+        return smooting ? 0 : max_iterations;
+      }
+      if (i == save_at) {
+        zr_saved = zr;
+        zi_saved = zi;
+        save_at *= 2;
+      }
+    }
+  }
+
+  if (!smooting) {
+    return i;
+  }
+  if (!escaped) {
+    return 0;
+  }
+  // The escaped orbit does not need the precision to reach the smoothing
+  // radius. Double is deterministic as well since fp-contract is off.
+  const double G = 256.0 * 256.0;
+  Eigen::Vector2d Zn(zr.toDouble(), zi.toDouble());
+  while (Zn.dot(Zn) <= G) {
+    i++;
+    if (i > max_iterations - 1) {
+      return 0;
+    }
+    mandelbrotIteration(c, Zn);
+  }
+  const double magnitude = Zn.dot(Zn);
+  return (i - std::log2(std::log2(magnitude)) + 4.0) * max_iterations;
+}
+
+void Mandelbrot::mandelbrot(const FixedPoint &origin_re,
+                            const FixedPoint &origin_im,
+                            const double *re,
+                            const double *im,
+                            int n,
+                            double *result) const {
+  const Eigen::Vector2d origin(origin_re.toDouble(), origin_im.toDouble());
+  for (int i = 0; i < n; i++) {
+    const Eigen::Vector2d c(origin.x() + re[i], origin.y() + im[i]);
+    if (std::abs(c.x()) > 2. || std::abs(c.y()) > 2.) {
+      result[i] = mandelbrot(c);
+      continue;
+    }
+    result[i] = mandelbrot(origin_re + FixedPoint(re[i]),
+                           origin_im + FixedPoint(im[i]));
+  }
+}
+
+template <typename T>
+double
+Mandelbrot::mandelbrot_classic(const Eigen::Matrix<T, 2, 1> &position) const {
+  return formula::dispatch(iteration_formula, [&](auto f) {
+    return escapeTime<false, decltype(f)>(position);
+  });
+}
+
+template <typename T>
+double
+Mandelbrot::mandelbrot_smooth(const Eigen::Matrix<T, 2, 1> &position) const {
+  return formula::dispatch(iteration_formula, [&](auto f) {
+    return escapeTime<true, decltype(f)>(position);
+  });
+}
+
+template <bool Smooth, class Formula, typename T>
+double Mandelbrot::escapeTime(const Eigen::Matrix<T, 2, 1> &position) const {
+  if (iteration_formula == formula::MANDELBROT && isInsideM1M2(position)) {
+    return 0;
+  }
+  if (isInsideComponent(position.x(), position.y())) {
+    component_shortcuts.fetch_add(1, std::memory_order_relaxed);
+    return Smooth ? 0 : max_iterations;
+  }
+  Eigen::Matrix<T, 2, 1> Zn(0.0, 0.0);
+  Eigen::Matrix<T, 2, 1> Z_saved(0.0, 0.0);
+  const T G = Smooth ? 256.0 * 256.0 : 4.;
+
+  double i = 0.;
+  if (!iterateFormula<Formula>(position, G, Zn, Z_saved, i)) {
+    return Smooth ? 0 : max_iterations;
+  }
+  if (!Smooth) {
+    return i;
   }
 
   if (i > max_iterations - 1)
     return 0;
 
   // smoothing
-  i = (i - std::log2(std::log2(Zn.dot(Zn))) + 4.0) * max_iterations;
-  return i;
+  const double magnitude = Zn.dot(Zn);
+  return formula::smooth(i, magnitude, max_iterations, Formula::degree);
+}
+
+template <typename T>
+void Mandelbrot::scalarBatch(const double *re,
+                             const double *im,
+                             int n,
+                             double *result) const {
+  formula::dispatch(iteration_formula, [&](auto f) {
+    if (smooting) {
+      scalarBatchLoop<true, decltype(f), T>(re, im, n, result);
+    } else {
+      scalarBatchLoop<false, decltype(f), T>(re, im, n, result);
+    }
+  });
 }
 
-bool Mandelbrot::isInsideM1M2(const Eigen::Vector2d &position) const {
-  const double c2 = position.dot(position);
+template <bool Smooth, class Formula, typename T>
+void Mandelbrot::scalarBatchLoop(const double *re,
+                                 const double *im,
+                                 int n,
+                                 double *result) const {
+  for (int i = 0; i < n; i++) {
+    const Eigen::Matrix<T, 2, 1> position(static_cast<T>(re[i]),
+                                          static_cast<T>(im[i]));
+    result[i] = escapeTime<Smooth, Formula>(position);
+  }
+}
+
+template <typename T>
+bool Mandelbrot::iterate(const Eigen::Matrix<T, 2, 1> &position,
+                         T G,
+                         Eigen::Matrix<T, 2, 1> &Zn,
+                         Eigen::Matrix<T, 2, 1> &Z_saved,
+                         double &i) const {
+  switch (iteration_formula) {
+  case formula::MULTIBROT_3:
+    return iterateFormula<formula::Multibrot<3>>(position, G, Zn, Z_saved, i);
+  case formula::MULTIBROT_4:
+    return iterateFormula<formula::Multibrot<4>>(position, G, Zn, Z_saved, i);
+  case formula::BURNING_SHIP:
+    return iterateFormula<formula::BurningShip>(position, G, Zn, Z_saved, i);
+  case formula::TRICORN:
+    return iterateFormula<formula::Tricorn>(position, G, Zn, Z_saved, i);
+  case formula::MANDELBROT:
+    break;
+  }
+  return iterateFormula<formula::Quadratic>(position, G, Zn, Z_saved, i);
+}
+
+template <class Formula, typename T>
+bool Mandelbrot::iterateFormula(const Eigen::Matrix<T, 2, 1> &position,
+                                T G,
+                                Eigen::Matrix<T, 2, 1> &Zn,
+                                Eigen::Matrix<T, 2, 1> &Z_saved,
+                                double &i) const {
+  // Brent's cycle detection: Z is saved at iteration 1, 2, 4, 8, ... and
+  // compared with every following Z. If an orbit comes back to the saved Z it
+  // is caught in an attracting cycle and will never escape. Z_saved starts as
+  // the start Z and is passed back, so resuming at i compares with the same
+  // Z and saves at the same iterations as without resuming.
+  const T epsilon = periodicity_epsilon;
+  double save_at = 1;
+  while (save_at <= i) {
+    save_at *= 2;
+  }
+  const T cr = position.x();
+  const T ci = position.y();
+  T zr = Zn.x();
+  T zi = Zn.y();
+  T zr_saved = Z_saved.x();
+  T zi_saved = Z_saved.y();
+  bool periodic = false;
+  for (; i < max_iterations; i++) {
+    Formula::template step<formula::ScalarOps<T>>(zr, zi, cr, ci);
+    if (zr * zr + zi * zi > G) {
+      break;
+    }
+    if (periodicity_check) {
+      if (std::abs(zr - zr_saved) < epsilon &&
+          std::abs(zi - zi_saved) < epsilon) {
+        periodicity_shortcuts.fetch_add(1, std::memory_order_relaxed);
+        periodic = true;
+        break;
+      }
+      if (i == save_at) {
+        zr_saved = zr;
+        zi_saved = zi;
+        save_at *= 2;
+      }
+    }
+  }
+  Zn = Eigen::Matrix<T, 2, 1>(zr, zi);
+  Z_saved = Eigen::Matrix<T, 2, 1>(zr_saved, zi_saved);
+  return !periodic;
+}
+
+template <typename T>
+bool Mandelbrot::isInsideM1M2(const Eigen::Matrix<T, 2, 1> &position) const {
+  const T c2 = position.dot(position);
   // skip computation inside M1 -
   // http://iquilezles.org/www/articles/mset_1bulb/mset1bulb.htm
-  if (256.0 * c2 * c2 - 96.0 * c2 + 32.0 * position.x() - 3.0 < 0.0)
+  if (T(256.0) * c2 * c2 - T(96.0) * c2 + T(32.0) * position.x() - T(3.0) <
+      T(0.0))
     return true;
   // skip computation inside M2 -
   // http://iquilezles.org/www/articles/mset_2bulb/mset2bulb.htm
-  if (16.0 * (c2 + 2.0 * position.x() + 1.0) - 1.0 < 0.0)
+  if (T(16.0) * (c2 + T(2.0) * position.x() + T(1.0)) - T(1.0) < T(0.0))
     return true;
 
   return false;
 }
 
+Mandelbrot::TILE Mandelbrot::classifyTile(const Interval &re,
+                                          const Interval &im,
+                                          double &value) const {
+  if (iteration_formula != formula::MANDELBROT) {
+    return TILE_UNKNOWN;
+  }
+  // Same formulas as isInsideM1M2() but for the whole tile. Without smoothing
+  // mandelbrot_classic() returns 0 inside M1 and M2 but max_iterations for the
+  // other inner points, so the tile must be either completely inside or
+  // completely outside of M1 and M2.
+  const Interval c2 = sqr(re) + sqr(im);
+  const Interval m1 = Interval(256.) * sqr(c2) - Interval(96.) * c2 +
+                      Interval(32.) * re - Interval(3.);
+  const Interval m2 = sqr(re + Interval(1.)) + sqr(im);
+  if (m1.hi < 0. || m2.hi < 1. / 16.) {
+    value = 0;
+    return TILE_INSIDE;
+  }
+  const bool outside_m1m2 = m1.lo >= 0. && m2.lo >= 1. / 16.;
+  // the components do not overlap M1 and M2
+  if (component_lookup && HyperbolicComponents::get().isInside(re, im)) {
+    value = smooting ? 0 : max_iterations;
+    return TILE_INSIDE;
+  }
+
+  Interval zr, zi;
+  for (unsigned int i = 0; i < max_iterations; i++) {
+    const Interval zr_new = sqr(zr) - sqr(zi) + re;
+    const Interval zi_new = Interval(2.) * zr * zi + im;
+    const Interval magnitude = sqr(zr_new) + sqr(zi_new);
+    if (magnitude.lo > 4.) {
+      // Every point escapes in this iteration, see iterate().
+      if (smooting || !outside_m1m2) {
+        return TILE_UNKNOWN;
+      }
+      value = i;
+      return TILE_ESCAPES;
+    }
+    if (magnitude.hi > 4.) {
+      // some points escape now, others later
+      return TILE_UNKNOWN;
+    }
+    // If the box maps into itself, no orbit can ever leave it.
+    if (zr.contains(zr_new) && zi.contains(zi_new)) {
+      break;
+    }
+    zr = zr_new;
+    zi = zi_new;
+  }
+  if (smooting) {
+    value = 0;
+    return TILE_INSIDE;
+  }
+  if (!outside_m1m2) {
+    return TILE_UNKNOWN;
+  }
+  value = max_iterations;
+  return TILE_INSIDE;
+}
+
 void Mandelbrot::setSmoothing(bool s) { smooting = s; }
 
+void Mandelbrot::setFormula(formula::FORMULA f) { iteration_formula = f; }
+
 bool Mandelbrot::getSmoothing() const { return smooting; }
 
-void Mandelbrot::mandelbrotIteration(const Eigen::Vector2d &position,
-                                     Eigen::Vector2d &Zn) {
-  Zn = Eigen::Vector2d(Zn.x() * Zn.x() - Zn.y() * Zn.y(), 2 * Zn.x() * Zn.y()) +
+void Mandelbrot::setPeriodicityCheck(bool check) { periodicity_check = check; }
+
+bool Mandelbrot::getPeriodicityCheck() const { return periodicity_check; }
+
+void Mandelbrot::setComponentLookup(bool lookup) {
+  component_lookup = lookup;
+  if (lookup) {
+    // build the table now and not in the first frame which needs it
+    HyperbolicComponents::get();
+  }
+}
+
+bool Mandelbrot::getComponentLookup() const { return component_lookup; }
+
+void Mandelbrot::setPeriodicityEpsilon(double epsilon) {
+  periodicity_epsilon = epsilon;
+}
+
+void Mandelbrot::resetStatistics() {
+  periodicity_shortcuts = 0;
+  component_shortcuts = 0;
+}
+
+unsigned long Mandelbrot::getPeriodicityShortcuts() const {
+  return periodicity_shortcuts;
+}
+
+unsigned long Mandelbrot::getComponentShortcuts() const {
+  return component_shortcuts;
+}
+
+bool Mandelbrot::isVectorizationSupported(VECTORIZATION v) {
+  switch (v) {
+  case VECTORIZATION::SCALAR:
+    return true;
+#ifdef MANDELBROT_SIMD_X86
+  case VECTORIZATION::AVX2:
+    return __builtin_cpu_supports("avx2");
+  case VECTORIZATION::AVX512:
+    return __builtin_cpu_supports("avx512f");
+#endif
+  default:
+    return false;
+  }
+}
+
+std::string Mandelbrot::vectorizationName(VECTORIZATION v) {
+  switch (v) {
+  case VECTORIZATION::SCALAR:
+    return "scalar";
+  case VECTORIZATION::AVX2:
+    return "AVX2";
+  case VECTORIZATION::AVX512:
+    return "AVX-512";
+  }
+  return "unknown";
+}
+
+bool Mandelbrot::setVectorization(VECTORIZATION v) {
+  if (!isVectorizationSupported(v)) {
+    return false;
+  }
+  vectorization = v;
+  escape_time_batch = nullptr;
+  escape_time_batch_float = nullptr;
+#ifdef MANDELBROT_SIMD_X86
+  if (v == VECTORIZATION::AVX2) {
+    escape_time_batch = &kernel::escapeTimeAVX2;
+    escape_time_batch_float = &kernel::escapeTimeAVX2Float;
+  } else if (v == VECTORIZATION::AVX512) {
+    escape_time_batch = &kernel::escapeTimeAVX512;
+    escape_time_batch_float = &kernel::escapeTimeAVX512Float;
+  }
+#endif
+  return true;
+}
+
+template <typename T>
+void Mandelbrot::mandelbrotIteration(const Eigen::Matrix<T, 2, 1> &position,
+                                     Eigen::Matrix<T, 2, 1> &Zn) {
+  Zn = Eigen::Matrix<T, 2, 1>(Zn.x() * Zn.x() - Zn.y() * Zn.y(),
+                              T(2) * Zn.x() * Zn.y()) +
        position;
 }
 
+template double
+Mandelbrot::mandelbrot_classic(const Eigen::Vector2d &position) const;
+template double
+Mandelbrot::mandelbrot_classic(const Eigen::Vector2f &position) const;
+template double
+Mandelbrot::mandelbrot_smooth(const Eigen::Vector2d &position) const;
+template double
+Mandelbrot::mandelbrot_smooth(const Eigen::Vector2f &position) const;
+template bool Mandelbrot::isInsideM1M2(const Eigen::Vector2d &position) const;
+template bool Mandelbrot::isInsideM1M2(const Eigen::Vector2f &position) const;
+
 void Mandelbrot::setMaxIterations(unsigned int maxIt) {
   max_iterations = maxIt;
   inv_max_iterations_d = 1. / static_cast<double>(maxIt);
@@ -152,6 +898,13 @@ color::RGB<double> Mandelbrot::mandelbrotCOS(double iterations) {
   return rgb;
 }
 
+void Mandelbrot::mandelbrotSPLINE(double iterations, unsigned char *rgb) {
+  const color::RGB<int> rgbi = mandelbrotSPLINE(iterations);
+  rgb[0] = static_cast<unsigned char>(rgbi.r);
+  rgb[1] = static_cast<unsigned char>(rgbi.g);
+  rgb[2] = static_cast<unsigned char>(rgbi.b);
+}
+
 color::HSV<double> Mandelbrot::mandelbrotSPLINE(double iterations) {
   color::HSV<double> hsv;
 
@@ -5,22 +5,133 @@
 #include <base/structs.hpp>
 #include <base/typedefs.hpp>
 #include <eigen3/Eigen/Core>
+#include <mandelbrot/doubleDouble.hpp>
+#include <mandelbrot/fixedPoint.hpp>
+#include <mandelbrot/formula.hpp>
+#include <mandelbrot/hyperbolicComponents.h>
+#include <mandelbrot/interval.hpp>
+#include <mandelbrot/kernel.h>
 #include <spline.h>
+#include <atomic>
+#include <string>
 
 class Mandelbrot {
 public:
+  enum VECTORIZATION { SCALAR, AVX2, AVX512 };
+
+  // Result of classifyTile().
+  // TILE_UNKNOWN: the points of the tile may have different results.
+  // TILE_INSIDE: no point of the tile escapes.
+  // TILE_ESCAPES: all points of the tile escape at the same iteration.
+  enum TILE { TILE_UNKNOWN, TILE_INSIDE, TILE_ESCAPES };
+
   Mandelbrot();
   ~Mandelbrot() {}
 
   double mandelbrot(const Eigen::Vector2d &position) const;
+  // Iterates in single precision, see mandelbrotSinglePrecision().
+  double mandelbrot(const Eigen::Vector2f &position) const;
   double mandelbrot(int, int) const;
-  double mandelbrot_classic(const Eigen::Vector2d &position) const;
-  double mandelbrot_smooth(const Eigen::Vector2d &position) const;
-  bool isInsideM1M2(const Eigen::Vector2d &position) const;
+  // Evaluates the n points (re[i], im[i]) using the vectorized kernel chosen
+  // by setVectorization(). Same results as calling mandelbrot() n times.
+  void mandelbrot(const double *re,
+                  const double *im,
+                  int n,
+                  double *result) const;
+  // Same as above but iterating in float with twice the SIMD lanes. Good
+  // enough as long as the pixel distance is far above the float resolution.
+  void mandelbrotSinglePrecision(const double *re,
+                                 const double *im,
+                                 int n,
+                                 double *result) const;
+  // Same as above but with the state of kernel::EscapeTimeParams: Point i
+  // continues with Z = (zr[i], zi[i]) at start_iteration, which is the same
+  // for all points, and (saved_zr[i], saved_zi[i]) for the periodicity check.
+  // Both are written back and unresolved[i] is set to 1 if it did neither
+  // escape nor was classified as inside until max_iterations. Calling again
+  // with a higher max_iterations and the old one as start_iteration continues
+  // the unresolved points with the same results as in one go. Start a new
+  // state with Z = 0 and saved Z = 0 at iteration 0. The component lookup
+  // only applies to the points starting at iteration 0.
+  void mandelbrot(const double *re,
+                  const double *im,
+                  int n,
+                  unsigned int start_iteration,
+                  double *zr,
+                  double *zi,
+                  double *saved_zr,
+                  double *saved_zi,
+                  unsigned char *unresolved,
+                  double *result) const;
+  void mandelbrotSinglePrecision(const double *re,
+                                 const double *im,
+                                 int n,
+                                 unsigned int start_iteration,
+                                 double *zr,
+                                 double *zi,
+                                 double *saved_zr,
+                                 double *saved_zi,
+                                 unsigned char *unresolved,
+                                 double *result) const;
+  // Evaluates the n points (re[i], im[i]) of the Julia set of c = (c_re,
+  // c_im) with the formula and settings of mandelbrot(): the points are the
+  // start values of Z, c is fixed. Neither the M1/M2 test nor the component
+  // lookup apply to Julia sets.
+  void julia(double c_re,
+             double c_im,
+             const double *re,
+             const double *im,
+             int n,
+             double *result) const;
+  // Double-double precision for views too small for double. Only for
+  // formula::MANDELBROT like the fixed point below. Thread safe.
+  double mandelbrot(const DoubleDouble &re, const DoubleDouble &im) const;
+  // Evaluates the n points origin + (re[i], im[i]) in double-double.
+  void mandelbrot(const DoubleDouble &origin_re,
+                  const DoubleDouble &origin_im,
+                  const double *re,
+                  const double *im,
+                  int n,
+                  double *result) const;
+  // 4.124 fixed point, faster and a bit deeper than double-double. The
+  // iteration count is the same on every machine, the smooth value is not
+  // as it uses std::log2. Thread safe.
+  double mandelbrot(const FixedPoint &re, const FixedPoint &im) const;
+  // Evaluates the n points origin + (re[i], im[i]) in fixed point. Points
+  // outside of [-2, 2] escape in double, they would overflow the fixed point.
+  void mandelbrot(const FixedPoint &origin_re,
+                  const FixedPoint &origin_im,
+                  const double *re,
+                  const double *im,
+                  int n,
+                  double *result) const;
+  // Instantiated for double and float.
+  template <typename T>
+  double mandelbrot_classic(const Eigen::Matrix<T, 2, 1> &position) const;
+  template <typename T>
+  double mandelbrot_smooth(const Eigen::Matrix<T, 2, 1> &position) const;
+  template <typename T>
+  bool isInsideM1M2(const Eigen::Matrix<T, 2, 1> &position) const;
+  // Iterates all points c of [re.lo, re.hi] x [im.lo, im.hi] at once in
+  // interval arithmetic. If that proves that mandelbrot() returns the same for
+  // all of them, the result is written to value. With smoothing the escaping
+  // points differ, so TILE_ESCAPES is only found without. Thread safe.
+  TILE classifyTile(const Interval &re,
+                    const Interval &im,
+                    double &value) const;
 
   void mandelbrotGreyScale(double iterations, color::RGB<int> &rgb);
   color::HSV<double> mandelbrotSPLINE(double iterations);
   color::RGB<double> mandelbrotCOS(double iterations);
+  // Same colors as above written as 8 bit r, g, b into rgb[0..2], without the
+  // color classes. The cosine one is inline for the pixel loops.
+  void mandelbrotSPLINE(double iterations, unsigned char *rgb);
+  void mandelbrotCOS(double iterations, unsigned char *rgb) const {
+    const double a = 3.0 + iterations * cos_const_a;
+    rgb[0] = toByte(0.5 + 0.5 * std::cos(a + cos_const_b));
+    rgb[1] = toByte(0.5 + 0.5 * std::cos(a + cos_const_c));
+    rgb[2] = toByte(0.5 + 0.5 * std::cos(a + cos_const_d));
+  }
 
   double redistributeHue(double iteration);
 
@@ -38,9 +149,123 @@ public:
 
   bool getSmoothing() const;
 
+  // The iteration of mandelbrot(), see formula::FORMULA. The M1/M2 test, the
+  // component lookup and classifyTile() only work for formula::MANDELBROT.
+  void setFormula(formula::FORMULA f);
+
+  formula::FORMULA getFormula() const { return iteration_formula; }
+
+  // Stop iterating a point as soon as its orbit is found to be periodic.
+  void setPeriodicityCheck(bool check);
+
+  bool getPeriodicityCheck() const;
+
+  // Classify the points in the proven part of the hyperbolic components of
+  // period 3 and above as inside without iterating, see HyperbolicComponents.
+  // Only for double and float, the deep zoom kernels iterate every point.
+  // The lookup table is built by the first lookup or by enabling it here.
+  void setComponentLookup(bool lookup);
+
+  bool getComponentLookup() const;
+
+  // Two Z closer than epsilon (in x and y) count as the same point of a cycle.
+  void setPeriodicityEpsilon(double epsilon);
+
+  // Call before each frame, the statistics count over all calls since.
+  void resetStatistics();
+
+  // Number of points which were classified as inside by the periodicity check.
+  unsigned long getPeriodicityShortcuts() const;
+
+  // Number of points which were classified as inside by the component lookup.
+  unsigned long getComponentShortcuts() const;
+
+  // Returns false if the CPU does not support the given instruction set.
+  bool setVectorization(VECTORIZATION v);
+
+  VECTORIZATION getVectorization() const { return vectorization; }
+
+  static bool isVectorizationSupported(VECTORIZATION v);
+
+  static std::string vectorizationName(VECTORIZATION v);
+
 private:
-  static void mandelbrotIteration(const Eigen::Vector2d &poition,
-                                  Eigen::Vector2d &Zn);
+  // rounds like the conversion of color::RGB<double> to color::RGB<int>
+  static unsigned char toByte(double pigment) {
+    return static_cast<unsigned char>(std::round(pigment * 255.0));
+  }
+
+  // mandelbrot_classic() or mandelbrot_smooth() with the smoothing and the
+  // formula known at compile time.
+  template <bool Smooth, class Formula, typename T>
+  double escapeTime(const Eigen::Matrix<T, 2, 1> &position) const;
+
+  // The batch functions without a vectorized kernel. The smoothing and the
+  // formula are chosen once, the loop over the points has no branch on them.
+  template <typename T>
+  void scalarBatch(const double *re,
+                   const double *im,
+                   int n,
+                   double *result) const;
+
+  template <bool Smooth, class Formula, typename T>
+  void scalarBatchLoop(const double *re,
+                       const double *im,
+                       int n,
+                       double *result) const;
+
+  template <typename T>
+  bool iterate(const Eigen::Matrix<T, 2, 1> &position,
+               T G,
+               Eigen::Matrix<T, 2, 1> &Zn,
+               Eigen::Matrix<T, 2, 1> &Z_saved,
+               double &i) const;
+
+  template <class Formula, typename T>
+  bool iterateFormula(const Eigen::Matrix<T, 2, 1> &position,
+                      T G,
+                      Eigen::Matrix<T, 2, 1> &Zn,
+                      Eigen::Matrix<T, 2, 1> &Z_saved,
+                      double &i) const;
+
+  template <typename T>
+  static void mandelbrotIteration(const Eigen::Matrix<T, 2, 1> &poition,
+                                  Eigen::Matrix<T, 2, 1> &Zn);
+
+  bool isInsideComponent(double re, double im) const;
+
+  // Size of the chunks the points outside of the components are gathered in
+  // for the kernels.
+  static constexpr int COMPONENT_CHUNK = 256;
+
+  template <typename T>
+  double resume(const Eigen::Matrix<T, 2, 1> &position,
+                unsigned int start_iteration,
+                double &zr,
+                double &zi,
+                double &saved_zr,
+                double &saved_zi,
+                unsigned char &unresolved) const;
+
+  double julia(const Eigen::Vector2d &c, const Eigen::Vector2d &z0) const;
+
+  void mandelbrot(kernel::EscapeTimeBatch batch,
+                  const double *re,
+                  const double *im,
+                  int n,
+                  unsigned int start_iteration,
+                  double *zr,
+                  double *zi,
+                  double *saved_zr,
+                  double *saved_zi,
+                  unsigned char *unresolved,
+                  double *result) const;
+
+  void mandelbrot(kernel::EscapeTimeBatch batch,
+                  const double *re,
+                  const double *im,
+                  int n,
+                  double *result) const;
 
   unsigned int max_iterations = 0;
   double inv_max_iterations_d = 0.;
@@ -53,6 +278,19 @@ private:
   double cos_const_d = 1;
 
   bool smooting = false;
+
+  formula::FORMULA iteration_formula = formula::MANDELBROT;
+
+  bool periodicity_check = true;
+  double periodicity_epsilon = 1e-12;
+  mutable std::atomic<unsigned long> periodicity_shortcuts{0};
+
+  bool component_lookup = true;
+  mutable std::atomic<unsigned long> component_shortcuts{0};
+
+  VECTORIZATION vectorization = VECTORIZATION::SCALAR;
+  kernel::EscapeTimeBatch escape_time_batch = nullptr;
+  kernel::EscapeTimeBatch escape_time_batch_float = nullptr;
 };
 
 #endif
@@ -0,0 +1,167 @@
+#include <cmath>
+#include <complex>
+#include <mandelbrot/perturbation.h>
+
+void Perturbation::setReference(const Float &center_re,
+                                const Float &center_im,
+                                double radius) {
+  // Escape radius of the smooth coloring, big enough for the classic one.
+  const Float G = 256.0 * 256.0;
+
+  reference_re.clear();
+  reference_im.clear();
+  reference_re.reserve(max_iterations + 1);
+  reference_im.reserve(max_iterations + 1);
+
+  Float zr = 0;
+  Float zi = 0;
+  reference_re.push_back(0.);
+  reference_im.push_back(0.);
+  for (unsigned int i = 0; i < max_iterations; i++) {
+    const Float zr2 = zr * zr;
+    const Float zi2 = zi * zi;
+    zi = 2 * zr * zi + center_im;
+    zr = zr2 - zi2 + center_re;
+    reference_re.push_back(zr.convert_to<double>());
+    reference_im.push_back(zi.convert_to<double>());
+    if (zr2 + zi2 > G) {
+      break;
+    }
+  }
+
+  calculateSeriesApproximation(radius);
+}
+
+void Perturbation::calculateSeriesApproximation(double radius) {
+  // dz_n+1 = 2 * Z_n * dz_n + dz_n^2 + dc. Inserting
+  // dz_n = A_n * dc + B_n * dc^2 + C_n * dc^3 and comparing the coefficients:
+  // A_n+1 = 2 * Z_n * A_n + 1
+  // B_n+1 = 2 * Z_n * B_n + A_n^2
+  // C_n+1 = 2 * Z_n * C_n + 2 * A_n * B_n
+  typedef std::complex<double> Complex;
+  Complex A(0., 0.);
+  Complex B(0., 0.);
+  Complex C(0., 0.);
+  skipped_iterations = 0;
+
+  const double r2 = radius * radius;
+  // The truncated terms have to be negligible against the first order term.
+  // The cubic term is the largest one we keep, the first one we drop is
+  // smaller by about the same factor.
+  const double tolerance = 1e-10;
+  // The pixel orbit must still be close to the reference, otherwise it might
+  // escape or need a rebase during the skipped iterations.
+  const double max_distance = 1e-3;
+
+  // Do not skip the last reference iteration, the pixel loop needs one step.
+  const unsigned int last = getReferenceLength();
+  for (unsigned int n = 0; n + 1 < last; n++) {
+    const Complex Z(reference_re[n], reference_im[n]);
+    const Complex A_next = 2. * Z * A + 1.;
+    const Complex B_next = 2. * Z * B + A * A;
+    const Complex C_next = 2. * Z * C + 2. * A * B;
+
+    const double first_order = std::abs(A_next) * radius;
+    const double third_order = std::abs(C_next) * r2 * radius;
+    const Complex Z_next(reference_re[n + 1], reference_im[n + 1]);
+    if (third_order > tolerance * first_order ||
+        first_order > max_distance * std::abs(Z_next)) {
+      break;
+    }
+    A = A_next;
+    B = B_next;
+    C = C_next;
+    skipped_iterations = n + 1;
+  }
+
+  a_re = A.real();
+  a_im = A.imag();
+  b_re = B.real();
+  b_im = B.imag();
+  c_re = C.real();
+  c_im = C.imag();
+}
+
+double Perturbation::mandelbrot(double dc_re, double dc_im) const {
+  unsigned long pixel_rebases = 0;
+  const double result = iterate(dc_re, dc_im, pixel_rebases);
+  if (pixel_rebases > 0) {
+    rebases.fetch_add(pixel_rebases, std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void Perturbation::mandelbrot(const double *dc_re,
+                              const double *dc_im,
+                              int n,
+                              double *result) const {
+  unsigned long batch_rebases = 0;
+  for (int i = 0; i < n; i++) {
+    result[i] = iterate(dc_re[i], dc_im[i], batch_rebases);
+  }
+  if (batch_rebases > 0) {
+    rebases.fetch_add(batch_rebases, std::memory_order_relaxed);
+  }
+}
+
+double Perturbation::iterate(double dc_re,
+                             double dc_im,
+                             unsigned long &pixel_rebases) const {
+  const double G = smoothing ? 256.0 * 256.0 : 4.;
+  const unsigned int reference_length = getReferenceLength();
+
+  // start after the skipped iterations with the series approximation
+  const std::complex<double> dc(dc_re, dc_im);
+  const std::complex<double> dz0 =
+      ((std::complex<double>(c_re, c_im) * dc +
+        std::complex<double>(b_re, b_im)) *
+           dc +
+       std::complex<double>(a_re, a_im)) *
+      dc;
+  double dr = dz0.real();
+  double di = dz0.imag();
+  unsigned int m = skipped_iterations;
+  double magnitude = 0.;
+
+  double i = skipped_iterations;
+  for (; i < max_iterations; i++) {
+    const double zr = reference_re[m];
+    const double zi = reference_im[m];
+    const double tr = 2. * zr + dr;
+    const double ti = 2. * zi + di;
+    const double dr_next = tr * dr - ti * di + dc_re;
+    const double di_next = tr * di + ti * dr + dc_im;
+    m++;
+
+    const double full_re = reference_re[m] + dr_next;
+    const double full_im = reference_im[m] + di_next;
+    magnitude = full_re * full_re + full_im * full_im;
+    if (magnitude > G) {
+      break;
+    }
+
+    // Glitch detection: If the pixel orbit comes closer to 0 than to the
+    // reference orbit, dz is no longer small compared to Z and loses
+    // precision. Same if the reference escaped before the pixel. In both cases
+    // rebase: continue with the reference orbit from its start, Z_0 = 0 so
+    // the full z becomes the new dz.
+    if (magnitude < dr_next * dr_next + di_next * di_next ||
+        m == reference_length) {
+      dr = full_re;
+      di = full_im;
+      m = 0;
+      pixel_rebases++;
+    } else {
+      dr = dr_next;
+      di = di_next;
+    }
+  }
+
+  if (!smoothing) {
+    return i;
+  }
+  if (i > max_iterations - 1) {
+    return 0;
+  }
+  return (i - std::log2(std::log2(magnitude)) + 4.0) * max_iterations;
+}
@@ -0,0 +1,87 @@
+#ifndef PERTURBATION_H
+#define PERTURBATION_H
+
+#include <atomic>
+#include <boost/multiprecision/cpp_bin_float.hpp>
+#include <vector>
+
+// Deep zoom using perturbation theory: Only one reference orbit (the center
+// of the view) is calculated in high precision. Every pixel c = C + dc is
+// calculated as the difference dz to that orbit in double:
+// dz_n+1 = 2 * Z_n * dz_n + dz_n^2 + dc.
+// As long as dc can be represented as double (1e-300) this is as fast as the
+// double kernel.
+class Perturbation {
+public:
+  // 1024 bits are ~308 decimal digits, which is as deep as the double deltas
+  // can go anyway.
+  typedef boost::multiprecision::number<
+      boost::multiprecision::cpp_bin_float<
+          1024,
+          boost::multiprecision::digit_base_2>,
+      boost::multiprecision::et_off>
+      Float;
+
+  Perturbation() {}
+  ~Perturbation() {}
+
+  // Calculates the reference orbit of the given center and the series
+  // approximation which is valid for all dc with |dc| <= radius.
+  void setReference(const Float &center_re,
+                    const Float &center_im,
+                    double radius);
+
+  // Same escape times as Mandelbrot::mandelbrot(center + dc). The points
+  // which do not escape are iterated up to max_iterations: there is neither
+  // the M1/M2 test nor the periodicity check, which would compare Z closer
+  // than double resolves them. So the classic value inside is max_iterations
+  // also in M1 and M2, where Mandelbrot::mandelbrot() returns 0.
+  double mandelbrot(double dc_re, double dc_im) const;
+
+  void mandelbrot(const double *dc_re,
+                  const double *dc_im,
+                  int n,
+                  double *result) const;
+
+  // Call setReference() again after changing these.
+  void setMaxIterations(unsigned int maxIt) { max_iterations = maxIt; }
+
+  void setSmoothing(bool s) { smoothing = s; }
+
+  // Number of iterations skipped for every pixel by the series approximation.
+  unsigned int getSkippedIterations() const { return skipped_iterations; }
+
+  // Number of iterations until the reference escaped (or max_iterations).
+  unsigned int getReferenceLength() const {
+    return static_cast<unsigned int>(reference_re.size()) - 1;
+  }
+
+  void resetStatistics() { rebases = 0; }
+
+  // Number of times a pixel was rebased, see mandelbrot().
+  unsigned long getRebases() const { return rebases; }
+
+private:
+  void calculateSeriesApproximation(double radius);
+
+  // Counts the rebases into pixel_rebases.
+  double
+  iterate(double dc_re, double dc_im, unsigned long &pixel_rebases) const;
+
+  unsigned int max_iterations = 100;
+  bool smoothing = false;
+
+  // reference orbit Z_0 = 0 ... Z_n rounded to double
+  std::vector<double> reference_re;
+  std::vector<double> reference_im;
+
+  // dz_n = A * dc + B * dc^2 + C * dc^3 for n = skipped_iterations
+  unsigned int skipped_iterations = 0;
+  double a_re = 0., a_im = 0.;
+  double b_re = 0., b_im = 0.;
+  double c_re = 0., c_im = 0.;
+
+  mutable std::atomic<unsigned long> rebases{0};
+};
+
+#endif
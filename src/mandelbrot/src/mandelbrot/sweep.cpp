@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mandelbrot/sweep.h>
+#include <thread>
+
+void Sweep::Statistics::add(const Statistics &other) {
+  pixel += other.pixel;
+  interior += other.interior;
+  iterations += other.iterations;
+  if (histogram.size() < other.histogram.size()) {
+    histogram.resize(other.histogram.size(), 0);
+  }
+  for (size_t i = 0; i < other.histogram.size(); i++) {
+    histogram[i] += other.histogram[i];
+  }
+}
+
+Sweep::Sweep(double re0_,
+             double im0_,
+             double re1,
+             double im1,
+             long long width_,
+             long long height_)
+    : re0(re0_), im0(im0_), pixel_re((re1 - re0_) / width_),
+      pixel_im((im1 - im0_) / height_), width(width_), height(height_) {}
+
+Sweep::Statistics Sweep::run(Mandelbrot &mandelbrot, int num_threads) const {
+  mandelbrot.setSmoothing(false);
+  const auto start = std::chrono::steady_clock::now();
+
+  std::atomic<long long> next_tile{0};
+  std::vector<Statistics> thread_statistics(num_threads);
+  std::vector<std::thread> threadpool;
+  for (int t = 0; t < num_threads; t++) {
+    threadpool.push_back(std::thread(&Sweep::sweepTiles,
+                                     this,
+                                     std::cref(mandelbrot),
+                                     std::ref(next_tile),
+                                     std::ref(thread_statistics[t])));
+  }
+  std::for_each(threadpool.begin(),
+                threadpool.end(),
+                std::mem_fn(&std::thread::join));
+
+  Statistics statistics;
+  statistics.histogram.assign(mandelbrot.getMaxIterations(), 0);
+  for (const Statistics &s : thread_statistics) {
+    statistics.add(s);
+  }
+  statistics.seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  return statistics;
+}
+
+void Sweep::sweepTiles(const Mandelbrot &mandelbrot,
+                       std::atomic<long long> &next_tile,
+                       Statistics &statistics) const {
+  const unsigned int max_iterations = mandelbrot.getMaxIterations();
+  // the classic result is 0 inside M1/M2 as well as for escaping at once
+  const bool m1m2 = mandelbrot.getFormula() == formula::MANDELBROT;
+  const long long tiles_x = (width + tile_size - 1) / tile_size;
+  const long long tiles_y = (height + tile_size - 1) / tile_size;
+  statistics.histogram.assign(max_iterations, 0);
+
+  std::vector<double> re, im, result;
+  re.reserve(static_cast<size_t>(tile_size) * tile_size);
+  im.reserve(static_cast<size_t>(tile_size) * tile_size);
+  while (true) {
+    const long long tile = next_tile.fetch_add(1);
+    if (tile >= tiles_x * tiles_y) {
+      return;
+    }
+    const long long x0 = (tile % tiles_x) * tile_size;
+    const long long y0 = (tile / tiles_x) * tile_size;
+    const long long x1 = std::min(x0 + tile_size, width);
+    const long long y1 = std::min(y0 + tile_size, height);
+    re.clear();
+    im.clear();
+    for (long long y = y0; y < y1; y++) {
+      for (long long x = x0; x < x1; x++) {
+        re.push_back(re0 + x * pixel_re);
+        im.push_back(im0 + y * pixel_im);
+      }
+    }
+    const int n = static_cast<int>(re.size());
+    result.resize(n);
+    mandelbrot.mandelbrot(re.data(), im.data(), n, result.data());
+
+    statistics.pixel += n;
+    for (int i = 0; i < n; i++) {
+      const unsigned int escape_time = static_cast<unsigned int>(result[i]);
+      if (escape_time >= max_iterations ||
+          (escape_time == 0 && m1m2 &&
+           mandelbrot.isInsideM1M2(Eigen::Vector2d(re[i], im[i])))) {
+        statistics.interior++;
+        statistics.iterations += max_iterations;
+      } else {
+        statistics.histogram[escape_time]++;
+        statistics.iterations += escape_time;
+      }
+    }
+  }
+}
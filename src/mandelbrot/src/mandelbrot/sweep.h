@@ -0,0 +1,56 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <atomic>
+#include <mandelbrot/mandelbrot.h>
+#include <vector>
+
+// Statistics of the escape time over a grid far too large to keep in memory,
+// e.g. to estimate the area of the set. The grid is cut into tiles which the
+// threads take one by one. A thread only holds the results of its current
+// tile and reduces them into statistics of its own, which are added up when
+// all tiles are done.
+class Sweep {
+public:
+  struct Statistics {
+    long long pixel = 0;
+    // did not escape within max_iterations
+    long long interior = 0;
+    // sum of the escape times, max_iterations for the interior pixel
+    long long iterations = 0;
+    // histogram[i]: number of pixel which escaped at iteration i
+    std::vector<long long> histogram;
+    double seconds = 0.;
+
+    void add(const Statistics &other);
+  };
+
+  // Pixel (x, y) of the width x height grid is
+  // c = (re0 + x * (re1 - re0) / width, im0 + y * (im1 - im0) / height).
+  Sweep(double re0,
+        double im0,
+        double re1,
+        double im1,
+        long long width,
+        long long height);
+
+  // Edge length of the square tiles, a thread holds three doubles per pixel.
+  void setTileSize(int size) { tile_size = size; }
+
+  // Sweeps the grid with the iterations, formula and vectorization of
+  // mandelbrot. The statistics need the classic escape time, so the smoothing
+  // of mandelbrot is turned off.
+  Statistics run(Mandelbrot &mandelbrot, int num_threads) const;
+
+private:
+  void sweepTiles(const Mandelbrot &mandelbrot,
+                  std::atomic<long long> &next_tile,
+                  Statistics &statistics) const;
+
+  double re0, im0;
+  double pixel_re, pixel_im;
+  long long width, height;
+  int tile_size = 256;
+};
+
+#endif